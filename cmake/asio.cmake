@@ -14,4 +14,8 @@ target_include_directories(asio INTERFACE
 target_compile_definitions(asio INTERFACE
     ASIO_STANDALONE
     ASIO_HAS_STD_INVOKE_RESULT
-)
\ No newline at end of file
+)
+
+if(WIN32)
+    target_link_libraries(asio INTERFACE ws2_32 mswsock)
+endif()
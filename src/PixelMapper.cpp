@@ -3,16 +3,60 @@
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <iterator>
+#include <tuple>
 
 #include "utils/FlecsUtils.h"
-
-#include <imgui.h>
+#include "utils/ThreadPool.h"
+#include "artnet/ArtnetInput.h"
+#include "artnet/ArtnetOutput.h"
+#include "artnet/OutputPlan.h"
+#include "artnet/PixelPacking.h"
+#include "render/Bounds.h"
+#include "render/EffectGraph.h"
+#include "render/Sampler.h"
+#include "render/SpatialIndex.h"
 
 
 namespace PixelMapper{
 
 
 namespace App{
+    //pixels per render job, small enough to balance 16 cores on 100k pixels, large enough to amortize scheduling
+    static constexpr size_t RenderChunkSize = 4096;
+
+    void rebuildSampleMap(Patch::SampleMap& map, const Patch::PixelStore& store, const Patch::RenderArea& area, int width, int height){
+        Render::resizeSampleMap(map, store.x.size(), width, height);
+        ThreadPool::getShared().parallelFor(store.x.size(), RenderChunkSize,
+            [&](size_t begin, size_t end){
+                Render::buildSamples(map, store, area, begin, end);
+        });
+    }
+
+    //queue moved pixels for UpdateSpatialIndex, without a range the whole index is rebuilt
+    void markSpatialIndexDirty(flecs::entity patch, const Fixture::PixelRange* range){
+        auto* index = patch.try_get_mut<Patch::SpatialIndex>();
+        if(!index) return;
+        if(range) index->dirtyRanges.push_back({range->offset, range->offset + range->count});
+        else index->b_rebuild = true;
+        patch.add<Patch::SpatialIndexDirty>();
+    }
+
+    //order of the output plan: by universe, then by first pixel, unique since fixtures don't share pixels
+    //both the full and the partial rebuild use it, so fixtures that overlap in a universe resolve the same way in either
+    bool isBeforeInPlan(const Artnet::CopySpan& a, const Artnet::CopySpan& b){
+        if(a.universeId != b.universeId) return a.universeId < b.universeId;
+        return a.source < b.source;
+    }
+
+    //queue the universes a fixture left or entered for UpdateDmxUniverses
+    void markDmxUniversesDirty(flecs::entity patch, Fixture::UniverseSpan span){
+        auto* plan = patch.try_get_mut<Artnet::OutputPlan>();
+        if(!plan || span.count == 0) return;
+        for(int i = 0; i < span.count; i++) plan->dirtyUniverses.push_back(uint16_t(span.first + i));
+        patch.add<Patch::DmxUniversesDirty>();
+    }
+
     flecs::entity get(const flecs::world& w){
         return w.target<Is>();
     };
@@ -20,8 +64,10 @@ namespace App{
         flecs::query<Patch::Is> patch;
         flecs::query<Fixture::Is, Fixture::Layout, Fixture::DmxAddress> fixtureWithDmxInPatch;
         flecs::query<Fixture::Is, Fixture::Layout, Fixture::DmxAddress> fixtureInDmxUniverse;
-        flecs::query<Fixture::Is, Fixture::PixelData> fixtureWithPixelDataInPatch;
+        flecs::query<Fixture::Is, Fixture::PixelRange> fixtureWithPixelRangeInPatch;
+        flecs::query<Fixture::Is, const Fixture::PixelRange, Fixture::Bounds> fixtureBoundsInPatch;
         flecs::query<Artnet::Universe::Is, Artnet::Universe::Properties> dmxUniverseInPatch;
+        flecs::query<Artnet::Device::Is, Artnet::Device::IpAddress, Artnet::Device::UniverseRange> deviceInPatch;
     };
     const Queries& getQueries(const flecs::world& w){
         return get(w).get<Queries>();
@@ -40,17 +86,25 @@ namespace Patch{
 
         auto newPatch = world.entity()
             .add<Patch::Is>()
-            .add<Patch::Settings>()
             .add<Patch::RenderArea>()
+            .add<Patch::PixelStore>()
+            .add<Patch::SpatialIndex>()
+            .set<Patch::ArtnetOutput>({std::make_shared<Artnet::OutputEngine>()})
+            .set<Patch::Settings>({44.0f})
+            .set<Patch::Effect>({std::make_shared<Render::EffectGraph>(Render::createRippleEffect())})
+            .add<Patch::DmxUniverseMap>()
+            .add<Artnet::OutputPlan>()
             .child_of(patchFolder);
 
         newPatch.set_name(patchName.c_str());
 
         auto fixtureFolder = world.entity("FixtureFolder").child_of(newPatch);
         auto dmxOutputFolder = world.entity("DmxOutputFolder").child_of(newPatch);
+        auto deviceFolder = world.entity("DeviceFolder").child_of(newPatch);
 
         newPatch.add<Patch::FixtureFolder>(fixtureFolder);
         newPatch.add<Patch::DmxUniverseFolder>(dmxOutputFolder);
+        newPatch.add<Patch::DeviceFolder>(deviceFolder);
         
         return newPatch;
     }
@@ -78,6 +132,42 @@ namespace Patch{
         });
     }
 
+    bool isActive(flecs::entity patch){
+        const auto* settings = patch.try_get<Patch::Settings>();
+        return settings && settings->b_active;
+    }
+
+    void iterateActive(flecs::entity pixelMapper, std::function<void(flecs::entity patch)> fn){
+        iterate(pixelMapper, [&fn](flecs::entity patch){
+            if(isActive(patch)) fn(patch);
+        });
+    }
+
+    void enableArtnetInput(flecs::entity patch, Artnet::MergeMode mode){
+        if(!patch.is_valid()) return;
+        Patch::ArtnetInput input;
+        if(const auto* current = patch.try_get<Patch::ArtnetInput>()) input = *current;
+        if(!input.engine) input.engine = std::make_shared<Artnet::InputEngine>();
+        input.mode = mode;
+        patch.set<Patch::ArtnetInput>(input);
+    }
+
+    void disableArtnetInput(flecs::entity patch){
+        if(!patch.is_valid()) return;
+        const auto* input = patch.try_get<Patch::ArtnetInput>();
+        if(!input) return;
+        //leave the universes as the pixels wrote them
+        if(input->engine){
+            Artnet::Universe::iterate(patch, [&](flecs::entity universe, Artnet::Universe::Properties& properties){
+                input->engine->restorePixels(properties.universeId, universe.get_mut<Artnet::Universe::Channels>().channels);
+            });
+        }
+        patch.remove<Patch::ArtnetInput>();
+        //back to sending only the used channels
+        patch.add<Patch::DmxRoutingDirty>();
+        patch.add<Patch::DmxMapDirty>();
+    }
+
 }//namespace Patch
 
 
@@ -88,7 +178,8 @@ namespace Fixture{
         auto newFixture = patch.world().entity()
             .child_of(fixtureList)
             .add<Fixture::Is>()
-            .add<Fixture::PixelData>();
+            .set<Fixture::PixelRange>({0, 0})
+            .add<Fixture::Bounds>();
 
         Fixture::Layout layout{
             .pixelCount = numPixels,
@@ -117,6 +208,70 @@ namespace Fixture{
         return newFixture;
     }
 
+    template<typename ShapeType>
+    std::vector<flecs::entity> createBulk(flecs::entity patch, const char* namePrefix, std::span<const ShapeType> shapes, std::span<const Layout> layouts, std::span<const DmxAddress> addresses){
+        size_t count = shapes.size();
+        auto fixtureList = patch.target<Patch::FixtureFolder>();
+        if(!fixtureList.is_valid() || count == 0) return {};
+        if(layouts.size() != count || addresses.size() != count) return {};
+        flecs::world world = patch.world();
+
+        int firstNumber = Fixture::getCountWithDmx(patch) + 1;
+        std::vector<Fixture::PixelRange> pixelRanges(count, Fixture::PixelRange{0, 0});
+
+        //the dirty tags are part of the initial table, so the layout and dmx observers don't move every entity again
+        ecs_bulk_desc_t desc = {};
+        desc.count = int32_t(count);
+        desc.ids[0] = world.id<Fixture::Is>();
+        desc.ids[1] = ecs_pair(flecs::ChildOf, fixtureList);
+        desc.ids[2] = world.id<Fixture::PixelRange>();
+        desc.ids[3] = world.id<Fixture::Layout>();
+        desc.ids[4] = world.id<Fixture::DmxAddress>();
+        desc.ids[5] = world.pair<Fixture::WithShape, ShapeType>();
+        desc.ids[6] = world.id<Fixture::LayoutDirty>();
+        desc.ids[7] = world.id<Fixture::PixelPositionsDirty>();
+        desc.ids[8] = world.id<Fixture::DmxMapDirty>();
+        desc.ids[9] = world.id<Fixture::Bounds>();
+        void* data[] = {
+            nullptr,
+            nullptr,
+            pixelRanges.data(),
+            const_cast<Fixture::Layout*>(layouts.data()),
+            const_cast<Fixture::DmxAddress*>(addresses.data()),
+            const_cast<ShapeType*>(shapes.data()),
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr //default constructed, dirty
+        };
+        desc.data = data;
+        const ecs_entity_t* ids = ecs_bulk_init(world, &desc);
+
+        std::vector<flecs::entity> fixtures;
+        fixtures.reserve(count);
+        for(size_t i = 0; i < count; i++) fixtures.push_back(world.entity(ids[i]));
+
+        //names move each entity once more, batched in one deferred block
+        world.defer_begin();
+        std::string fixtureName;
+        for(size_t i = 0; i < count; i++){
+            fixtureName = namePrefix + std::to_string(firstNumber + i);
+            fixtures[i].set_name(fixtureName.c_str());
+        }
+        patch.add<Patch::PixelStoreDirty>();
+        world.defer_end();
+
+        return fixtures;
+    }
+
+    std::vector<flecs::entity> createLines(flecs::entity patch, std::span<const Shape::Line> lines, std::span<const Layout> layouts, std::span<const DmxAddress> addresses){
+        return createBulk(patch, "Line Fixture ", lines, layouts, addresses);
+    }
+
+    std::vector<flecs::entity> createCircles(flecs::entity patch, std::span<const Shape::Circle> circles, std::span<const Layout> layouts, std::span<const DmxAddress> addresses){
+        return createBulk(patch, "Circle Fixture ", circles, layouts, addresses);
+    }
+
     void select(flecs::entity patch, flecs::entity fixture){
         patch.add<Patch::SelectedFixture>(fixture);
     }
@@ -128,6 +283,89 @@ namespace Fixture{
         patch.remove<Patch::SelectedFixture>(flecs::Wildcard);
     }
 
+    //range containing the pixel, null if none
+    static const Patch::PixelStore::FixtureRange* findFixtureRange(const Patch::PixelStore& store, uint32_t pixel){
+        auto it = std::upper_bound(store.fixtureRanges.begin(), store.fixtureRanges.end(), pixel,
+            [](uint32_t pixel, const Patch::PixelStore::FixtureRange& range){ return pixel < range.offset; });
+        if(it == store.fixtureRanges.begin()) return nullptr;
+        --it;
+        if(pixel >= it->offset + it->count) return nullptr;
+        return &*it;
+    }
+
+    flecs::entity findByPixel(flecs::entity patch, uint32_t pixel){
+        const auto* store = patch.try_get<Patch::PixelStore>();
+        if(!store) return flecs::entity::null();
+        const auto* range = findFixtureRange(*store, pixel);
+        //fixtures deleted since the last UpdatePixelStore are still listed
+        if(!range || !range->fixture.is_alive()) return flecs::entity::null();
+        return range->fixture;
+    }
+
+    flecs::entity findByMostPixels(flecs::entity patch, const std::vector<uint32_t>& sortedPixels){
+        const auto* store = patch.try_get<Patch::PixelStore>();
+        if(!store) return flecs::entity::null();
+        flecs::entity best = flecs::entity::null();
+        size_t bestCount = 0;
+        //one binary search per fixture that has pixels in the list, pixels of the same fixture are skipped in one step
+        auto it = sortedPixels.begin();
+        while(it != sortedPixels.end()){
+            const auto* range = findFixtureRange(*store, *it);
+            if(!range){
+                it++;
+                continue;
+            }
+            auto end = std::lower_bound(it, sortedPixels.end(), range->offset + range->count);
+            size_t count = end - it;
+            if(count > bestCount && range->fixture.is_alive()){
+                bestCount = count;
+                best = range->fixture;
+            }
+            it = end;
+        }
+        return best;
+    }
+
+    int getChannelCount(ChannelOrder order){
+        switch(order){
+            case ChannelOrder::R:       return 1;
+            case ChannelOrder::RG:      return 2;
+            case ChannelOrder::RGB:
+            case ChannelOrder::RBG:
+            case ChannelOrder::GRB:
+            case ChannelOrder::GBR:
+            case ChannelOrder::BRG:
+            case ChannelOrder::BGR:     return 3;
+            case ChannelOrder::RGBW:
+            case ChannelOrder::GRBW:
+            case ChannelOrder::WRGB:    return 4;
+            case ChannelOrder::RGB16:
+            case ChannelOrder::GRB16:   return 6;
+            case ChannelOrder::RGBW16:  return 8;
+            default:                    return 4;
+        }
+    }
+
+    const char* getChannelOrderName(ChannelOrder order){
+        switch(order){
+            case ChannelOrder::R:       return "R";
+            case ChannelOrder::RG:      return "RG";
+            case ChannelOrder::RGB:     return "RGB";
+            case ChannelOrder::RBG:     return "RBG";
+            case ChannelOrder::GRB:     return "GRB";
+            case ChannelOrder::GBR:     return "GBR";
+            case ChannelOrder::BRG:     return "BRG";
+            case ChannelOrder::BGR:     return "BGR";
+            case ChannelOrder::RGBW:    return "RGBW";
+            case ChannelOrder::GRBW:    return "GRBW";
+            case ChannelOrder::WRGB:    return "WRGB";
+            case ChannelOrder::RGB16:   return "RGB 16bit";
+            case ChannelOrder::GRB16:   return "GRB 16bit";
+            case ChannelOrder::RGBW16:  return "RGBW 16bit";
+            default:                    return "Unknown";
+        }
+    }
+
     void setDmxProperties(flecs::entity fixture, uint16_t universe, uint16_t startAddress){
         if(!fixture.is_valid()) return;
         auto* dmx = fixture.try_get_mut<Fixture::DmxAddress>();
@@ -173,59 +411,30 @@ namespace Fixture{
         });
     }
 
-    void iterateWithPixelData(flecs::entity patch, std::function<void(flecs::entity fixture, Fixture::PixelData&)> fn){
+    void iterateWithPixelRange(flecs::entity patch, std::function<void(flecs::entity fixture, Fixture::PixelRange&)> fn){
         auto fixtureFolder = patch.target<Patch::FixtureFolder>();
         if(!fixtureFolder.is_valid()) return;
-        App::getQueries(patch.world()).fixtureWithPixelDataInPatch
+        App::getQueries(patch.world()).fixtureWithPixelRangeInPatch
         .set_var("parent", fixtureFolder)
-        .each([fn](flecs::entity fixture, Fixture::Is, Fixture::PixelData& pixelData){
-            fn(fixture, pixelData);
+        .each([fn](flecs::entity fixture, Fixture::Is, Fixture::PixelRange& pixelRange){
+            fn(fixture, pixelRange);
         });
     }
 
-    void setPixelPositions(PixelData& pd, std::function<glm::vec3(float range, int index, size_t count)> pos_func) {
-        int count = pd.positions.size();
+    bool setPixelPositions(Patch::PixelStore& store, const PixelRange& pr, std::function<glm::vec3(float range, int index, size_t count)> pos_func) {
+        if(pr.offset + pr.count > store.x.size()) return false;
+        int count = pr.count;
+        float* x = store.x.data() + pr.offset;
+        float* y = store.y.data() + pr.offset;
+        float* z = store.z.data() + pr.offset;
         for(int i = 0; i < count; i++){
             float range = count > 1 ? (float)i / (float)(count - 1) : 0.0f;
-            pd.positions[i] = pos_func(range, i, count);
-        }
-    }
-
-    void writeColorsToUniverse(
-        const std::vector<ColorRGBW>& colors,
-        uint8_t* dmxChannels,
-        int universeId,
-        int fixtureStartUniverse,
-        int fixtureStartAddress,
-        int channelsPerColor)
-    {
-        //inside the current universe, get the possible channels relative to the fixture start
-        int universePixelStartChannel = (universeId - fixtureStartUniverse) * 512 - fixtureStartAddress;
-        int universePixelEndChannel = universePixelStartChannel + 511;
-
-        //divide by channelsPerColor to get the actual start and end pixels in this universe
-        int firstPixel = std::max(0, universePixelStartChannel) / channelsPerColor;
-        int lastPixel = std::min((int)colors.size() - 1, universePixelEndChannel / channelsPerColor);
-
-        //only iterate on the pixels that concern this universe
-        for (int i = firstPixel; i <= lastPixel; ++i) {
-            const uint8_t* colorPtr = reinterpret_cast<const uint8_t*>(&colors[i]);
-
-            //for each pixel, interate on channelcount
-            for (int ch = 0; ch < channelsPerColor; ++ch) {
-
-                // Get the position of this byte relative to the very first channel (0) of the fixture's start universe.
-                int byteGlobalPos = fixtureStartAddress + (i * channelsPerColor) + ch;
-                //then use this to get the bytes actual universe
-                int byteUniverse = fixtureStartUniverse + (byteGlobalPos / 512);
-
-                //if the byte is in the current universe, write it to the corresponding dmx channel
-                if (byteUniverse == universeId) {
-                    int byteLocalPos = byteGlobalPos % 512;
-                    dmxChannels[byteLocalPos] = colorPtr[ch];
-                }
-            }
+            glm::vec3 p = pos_func(range, i, count);
+            x[i] = p.x;
+            y[i] = p.y;
+            z[i] = p.z;
         }
+        return true;
     }
 
 }//namespace Fixture
@@ -262,6 +471,144 @@ namespace Artnet::Universe{
             .set<Properties>({universeId, 0});
     }
 
+    flecs::entity acquire(flecs::entity patch, uint16_t universeId){
+        auto& universes = patch.get_mut<Patch::DmxUniverseMap>().universes;
+        auto it = universes.find(universeId);
+        if(it != universes.end()){
+            it->second.get_mut<Properties>().referenceCount++;
+            return it->second;
+        }
+        flecs::entity universe = create(patch, universeId);
+        if(!universe.is_valid()) return universe;
+        universe.get_mut<Properties>().referenceCount = 1;
+        patch.get_mut<Patch::DmxUniverseMap>().universes[universeId] = universe;
+        patch.add<Patch::DmxRoutingDirty>();
+        return universe;
+    }
+
+    void release(flecs::entity patch, uint16_t universeId){
+        auto& universes = patch.get_mut<Patch::DmxUniverseMap>().universes;
+        auto it = universes.find(universeId);
+        if(it == universes.end()) return;
+        flecs::entity universe = it->second;
+        auto& properties = universe.get_mut<Properties>();
+        if(--properties.referenceCount > 0) return;
+        universes.erase(it);
+        universe.destruct();
+        patch.add<Patch::DmxRoutingDirty>();
+    }
+
+};//namespace Artnet::Universe
+
+
+
+namespace Artnet::Device{
+    flecs::entity create(flecs::entity patch, uint32_t ipAddress, uint16_t firstUniverse, uint16_t universeCount){
+        auto deviceFolder = patch.target<Patch::DeviceFolder>();
+        if(!deviceFolder.is_valid()) return flecs::entity::null();
+        int deviceCount = 0;
+        iterate(patch, [&](flecs::entity, IpAddress&, UniverseRange&){ deviceCount++; });
+        std::string deviceName = "Device " + std::to_string(deviceCount + 1);
+        return patch.world().entity()
+            .child_of(deviceFolder)
+            .set_name(deviceName.c_str())
+            .add<Is>()
+            .set<IpAddress>({ipAddress})
+            .set<UniverseRange>({firstUniverse, universeCount});
+    }
+
+    flecs::entity getPatch(flecs::entity device){
+        if(!device.is_valid() || !device.is_alive()) return flecs::entity::null();
+        flecs::entity deviceFolder = device.parent();
+        if(!deviceFolder.is_valid()) return flecs::entity::null();
+        flecs::entity patch = deviceFolder.parent();
+        if(patch.is_valid() && patch.has<Patch::Is>()) return patch;
+        return flecs::entity::null();
+    }
+
+    void iterate(flecs::entity patch, std::function<void(flecs::entity device, IpAddress&, UniverseRange&)> fn){
+        auto deviceFolder = patch.target<Patch::DeviceFolder>();
+        if(!deviceFolder.is_valid()) return;
+        App::getQueries(patch.world()).deviceInPatch.set_var("parent", deviceFolder)
+        .each([fn](flecs::entity device, Is, IpAddress& ip, UniverseRange& range){
+            fn(device, ip, range);
+        });
+    }
+
+    flecs::entity findForUniverse(flecs::entity patch, uint16_t universeId){
+        flecs::entity found = flecs::entity::null();
+        iterate(patch, [&](flecs::entity device, IpAddress& ip, UniverseRange& range){
+            if(found.is_valid()) return;
+            if(universeId >= range.first && universeId < range.first + range.count) found = device;
+        });
+        return found;
+    }
+
+    bool isSyncEnabled(flecs::entity device){
+        const auto* options = device.try_get<Options>();
+        return options ? options->b_sync : true;
+    }
+};//namespace Artnet::Device
+
+
+
+namespace Artnet{
+    const char* getMergeModeName(MergeMode mode){
+        switch(mode){
+            case MergeMode::HTP:        return "HTP";
+            case MergeMode::LTP:        return "LTP";
+            case MergeMode::Priority:   return "Priority";
+            default:                    return "Unknown";
+        }
+    }
+};//namespace Artnet
+
+
+
+namespace Artnet::Universe{
+    //assign every universe of the patch to the device that covers its id and rebuild the output packets
+    //only needed when universes were added or removed, their used size changed or the devices changed
+    void updateRouting(flecs::entity patch){
+        std::vector<std::tuple<flecs::entity, uint16_t, uint16_t>> universes;
+        iterate(patch, [&](flecs::entity universe, Properties& properties){
+            universes.push_back({universe, properties.universeId, properties.usedSize});
+        });
+
+        if(const auto* input = patch.try_get<Patch::ArtnetInput>()){
+            std::vector<uint16_t> universeIds;
+            for(auto& [universe, universeId, usedSize] : universes) universeIds.push_back(universeId);
+            if(input->engine) input->engine->setUniverses(universeIds);
+        }
+
+        //merged input may write any channel, only pixel output is limited to the used size
+        bool b_fullLength = patch.has<Patch::ArtnetInput>();
+
+        std::vector<OutputEngine::Route> routes;
+        std::vector<uint32_t> syncAddresses;
+        for(auto& [universe, universeId, usedSize] : universes){
+            flecs::entity device = Device::findForUniverse(patch, universeId);
+            if(!device.is_valid()){
+                universe.remove<SendTo>(flecs::Wildcard);
+                continue;
+            }
+            universe.add<SendTo>(device);
+            routes.push_back(OutputEngine::Route{
+                .ipAddress = device.get<Device::IpAddress>().address,
+                .universeId = universeId,
+                .length = b_fullLength ? uint16_t(DmxMaxLength) : getDmxLength(usedSize),
+                .channels = universe.get<Channels>().channels
+            });
+            //one sync per node, however many of its universes are used
+            uint32_t address = device.get<Device::IpAddress>().address;
+            if(Device::isSyncEnabled(device) && std::find(syncAddresses.begin(), syncAddresses.end(), address) == syncAddresses.end()){
+                syncAddresses.push_back(address);
+            }
+        }
+
+        if(auto* output = patch.try_get<Patch::ArtnetOutput>()){
+            if(output->engine) output->engine->setRoutes(routes, syncAddresses);
+        }
+    }
 };//namespace Artnet::Universe
 
 
@@ -270,12 +617,26 @@ namespace Patch{
         w.component<Is>();
         w.component<FixtureFolder>();
         w.component<DmxUniverseFolder>();
+        w.component<DeviceFolder>();
         w.component<SelectedFixture>();
         w.component<SelectedDmxUniverse>();
         w.component<DmxMapDirty>();
+        w.component<DmxUniversesDirty>();
+        w.component<DmxRoutingDirty>();
         w.component<RenderAreaDirty>();
+        w.component<PixelStoreDirty>();
+        w.component<SampleMapDirty>();
+        w.component<SpatialIndexDirty>();
         w.component<Settings>();
         w.component<RenderArea>();
+        w.component<PixelStore>();
+        w.component<ArtnetOutput>();
+        w.component<ArtnetInput>();
+        w.component<DmxUniverseMap>();
+        w.component<VideoInput>();
+        w.component<Effect>();
+        w.component<SampleMap>();
+        w.component<SpatialIndex>();
     }
 }
 namespace Fixture{
@@ -284,10 +645,15 @@ namespace Fixture{
         w.component<WithShape>();
         w.component<InUniverse>();
         w.component<LayoutDirty>();
+        w.component<DmxMapDirty>();
         w.component<PixelPositionsDirty>();
         w.component<Layout>();
+        w.component<ChannelFormat>();
         w.component<DmxAddress>();
-        w.component<PixelData>();
+        w.component<PixelRange>();
+        w.component<Bounds>();
+        w.component<UniverseSpan>();
+        w.component<CopySpans>();
     }
 }
 namespace Artnet::Universe{
@@ -298,6 +664,20 @@ namespace Artnet::Universe{
         w.component<Channels>().add(flecs::Sparse);
     }
 }
+namespace Artnet{
+    void import(flecs::world& w){
+        w.component<OutputPlan>();
+    }
+}
+namespace Artnet::Device{
+    void import(flecs::world& w){
+        w.component<Is>();
+        w.component<HasUniverse>();
+        w.component<IpAddress>();
+        w.component<UniverseRange>();
+        w.component<Options>();
+    }
+}
 namespace Shape{
     void import(flecs::world& w){
         w.component<Line>();
@@ -316,6 +696,8 @@ void App::import(flecs::world& w){
     Patch::import(w);
     Fixture::import(w);
     Artnet::Universe::import(w);
+    Artnet::Device::import(w);
+    Artnet::import(w);
     Shape::import(w);
 
     //————————————————— PAIR PROPERTIES ———————————————————
@@ -324,6 +706,7 @@ void App::import(flecs::world& w){
     w.component<Patch::SelectedFixture>().add(flecs::Exclusive);
     w.component<Patch::SelectedDmxUniverse>().add(flecs::Exclusive);
     w.component<SelectedPatch>().add(flecs::Exclusive);
+    w.component<Artnet::Universe::SendTo>().add(flecs::Exclusive);
 
     //———————————————————— TREE ROOT ——————————————————————
 
@@ -345,10 +728,16 @@ void App::import(flecs::world& w){
             .term().first(flecs::ChildOf).second("$parent")
             .with<Fixture::InUniverse>().second("$universe")
             .build(),
-        .fixtureWithPixelDataInPatch = w.query_builder<Fixture::Is, Fixture::PixelData>()
+        .fixtureWithPixelRangeInPatch = w.query_builder<Fixture::Is, Fixture::PixelRange>()
+            .term().first(flecs::ChildOf).second("$parent")
+            .build(),
+        .fixtureBoundsInPatch = w.query_builder<Fixture::Is, const Fixture::PixelRange, Fixture::Bounds>()
             .term().first(flecs::ChildOf).second("$parent")
             .build(),
         .dmxUniverseInPatch = w.query_builder<Artnet::Universe::Is, Artnet::Universe::Properties>()
+            .term().first(flecs::ChildOf).second("$parent")
+            .build(),
+        .deviceInPatch = w.query_builder<Artnet::Device::Is, Artnet::Device::IpAddress, Artnet::Device::UniverseRange>()
             .term().first(flecs::ChildOf).second("$parent")
             .build()
     };
@@ -360,58 +749,197 @@ void App::import(flecs::world& w){
     .with<Fixture::Is>()
     .each([](flecs::entity e, Fixture::Layout& l) {
         l.pixelCount = std::clamp<int>(l.pixelCount, 1, INT_MAX);
-        l.channelsPerPixel = std::clamp<int>(l.channelsPerPixel, 1, 4);
+        if(const auto* format = e.try_get<Fixture::ChannelFormat>()) l.channelsPerPixel = Fixture::getChannelCount(format->order);
+        else l.channelsPerPixel = std::clamp<int>(l.channelsPerPixel, 1, 4);
         e.add<Fixture::LayoutDirty>();
     });
+
+    w.observer<Fixture::ChannelFormat>("ObserveFixtureChannelFormat").event(flecs::OnSet)
+    .with<Fixture::Is>()
+    .with<Fixture::Layout>()
+    .each([](flecs::entity e, Fixture::ChannelFormat& f){
+        if(f.order >= Fixture::ChannelOrder::Count) f.order = Fixture::ChannelOrder::RGB;
+        //re-set the layout so its observer picks up the new channel count
+        Fixture::Layout layout = e.get<Fixture::Layout>();
+        e.set<Fixture::Layout>(layout);
+    });
     
     w.observer<Fixture::DmxAddress>("ObserveFixtureDmxAddress").event(flecs::OnSet)
     .with<Fixture::Is>()
     .each([](flecs::entity fixture, Fixture::DmxAddress& dmx){
         dmx.address = std::clamp<uint16_t>(dmx.address, 0, 511);
         dmx.universe = std::clamp<uint16_t>(dmx.universe, 0, 32767);
-        Fixture::getPatch(fixture).add<Patch::DmxMapDirty>();
+        fixture.add<Fixture::DmxMapDirty>();
+    });
+
+    w.observer<Fixture::PixelRange>("ReleaseFixturePixels").event(flecs::OnRemove)
+    .with<Fixture::Is>()
+    .each([](flecs::entity fixture, Fixture::PixelRange&){
+        flecs::entity patch = Fixture::getPatch(fixture);
+        if(patch.is_valid()) patch.add<Patch::PixelStoreDirty>();
+    });
+
+    w.observer<Fixture::UniverseSpan>("ReleaseFixtureUniverses").event(flecs::OnRemove)
+    .with<Fixture::Is>()
+    .each([](flecs::entity fixture, Fixture::UniverseSpan& span){
+        flecs::entity patch = Fixture::getPatch(fixture);
+        if(!patch.is_valid() || !patch.has<Patch::DmxUniverseMap>()) return;
+        for(int i = 0; i < span.count; i++) Artnet::Universe::release(patch, span.first + i);
+        patch.add<Patch::DmxMapDirty>();
+    });
+
+    w.observer<Patch::Settings>("ObservePatchSettings").event(flecs::OnSet)
+    .with<Patch::Is>()
+    .each([](flecs::entity patch, Patch::Settings& settings){
+        settings.refreshRate = std::clamp(settings.refreshRate, 1.0f, 1000.0f);
+        settings.keepAliveInterval = std::clamp(settings.keepAliveInterval, 0.0f, 10.0f);
+        if(auto* output = patch.try_get<Patch::ArtnetOutput>()){
+            if(!output->engine) return;
+            output->engine->setEnabled(settings.b_active);
+            output->engine->setRefreshRate(settings.refreshRate);
+            output->engine->setKeepAliveInterval(settings.keepAliveInterval);
+        }
+    });
+
+    w.observer<Patch::ArtnetInput>("ObservePatchArtnetInput").event(flecs::OnSet)
+    .with<Patch::Is>()
+    .each([](flecs::entity patch, Patch::ArtnetInput& input){
+        if(!input.engine) return;
+        if(auto* output = patch.try_get<Patch::ArtnetOutput>()){
+            if(output->engine) input.engine->ignoreSourcePort(output->engine->getLocalPort());
+        }
+        //the engine learns the universes of the patch in updateRouting
+        patch.add<Patch::DmxRoutingDirty>();
+        patch.add<Patch::DmxMapDirty>();
+    });
+
+    w.observer<Patch::VideoInput>("ObservePatchVideoInput").event(flecs::OnSet)
+    .with<Patch::Is>()
+    .each([](flecs::entity patch, Patch::VideoInput&){
+        patch.add<Patch::SampleMap>();
+        patch.add<Patch::SampleMapDirty>();
+    });
+
+    w.observer<Artnet::Device::IpAddress, Artnet::Device::UniverseRange>("ObserveDeviceRouting").event(flecs::OnSet)
+    .with<Artnet::Device::Is>()
+    .each([](flecs::entity device, Artnet::Device::IpAddress&, Artnet::Device::UniverseRange&){
+        flecs::entity patch = Artnet::Device::getPatch(device);
+        if(!patch.is_valid()) return;
+        patch.add<Patch::DmxRoutingDirty>();
+        patch.add<Patch::DmxMapDirty>();
+    });
+
+    w.observer<Artnet::Device::Options>("ObserveDeviceOptions").event(flecs::OnSet)
+    .with<Artnet::Device::Is>()
+    .each([](flecs::entity device, Artnet::Device::Options&){
+        flecs::entity patch = Artnet::Device::getPatch(device);
+        if(!patch.is_valid()) return;
+        patch.add<Patch::DmxRoutingDirty>();
+        patch.add<Patch::DmxMapDirty>();
     });
 
     //————————————————————— SYSTEMS ———————————————————————
     
-    w.system<Fixture::Layout, Fixture::PixelData>("UpdateFixtureLayout").with<Fixture::LayoutDirty>()
+    w.system<Fixture::Layout>("UpdateFixtureLayout").with<Fixture::LayoutDirty>()
     .kind(flecs::OnLoad)
     .with<Fixture::Is>()
     .immediate()
-    .each([](flecs::entity fixture, Fixture::Layout& l, Fixture::PixelData& pd){
-        pd.positions.resize(l.pixelCount);
-        pd.colors.resize(l.pixelCount);
+    .each([](flecs::entity fixture, Fixture::Layout& l){
         fixture.remove<Fixture::LayoutDirty>();
         fixture.add<Fixture::PixelPositionsDirty>(); //recalculate pixel positions
-        Fixture::getPatch(fixture).add<Patch::DmxMapDirty>(); //adjust the dmx output map
+        fixture.add<Fixture::DmxMapDirty>(); //recompile the copy spans
+        Fixture::getPatch(fixture).add<Patch::PixelStoreDirty>(); //resize the pixel range
+    });
+
+
+    //reassign the pixel ranges of all fixtures in a patch, only runs when pixel counts change or fixtures are added or removed
+    w.system<Patch::PixelStore>("UpdatePixelStore").with<Patch::PixelStoreDirty>()
+    .kind(flecs::OnLoad)
+    .with<Patch::Is>()
+    .immediate()
+    .each([](flecs::entity patch, Patch::PixelStore& oldStore){
+        struct Entry{
+            flecs::entity fixture;
+            Fixture::PixelRange* range;
+            Fixture::Bounds* bounds;
+            uint32_t count;
+        };
+        std::vector<Entry> entries;
+        uint32_t pixelCount = 0;
+        Fixture::iterateWithPixelRange(patch,
+            [&](flecs::entity fixture, Fixture::PixelRange& range){
+                const auto* layout = fixture.try_get<Fixture::Layout>();
+                uint32_t count = layout ? layout->pixelCount : 0;
+                entries.push_back({fixture, &range, fixture.try_get_mut<Fixture::Bounds>(), count});
+                pixelCount += count;
+        });
+
+        Patch::PixelStore store;
+        store.x.resize(pixelCount);
+        store.y.resize(pixelCount);
+        store.z.resize(pixelCount);
+        store.colors.resize(pixelCount);
+        store.fixtureRanges.reserve(entries.size());
+
+        //keep what survives of the previous pixels so unchanged fixtures don't need new positions
+        uint32_t offset = 0;
+        for(auto& entry : entries){
+            Fixture::PixelRange& range = *entry.range;
+            uint32_t keep = std::min(range.count, entry.count);
+            bool b_kept = range.offset + keep <= oldStore.x.size();
+            if(b_kept){
+                std::copy_n(oldStore.x.begin() + range.offset, keep, store.x.begin() + offset);
+                std::copy_n(oldStore.y.begin() + range.offset, keep, store.y.begin() + offset);
+                std::copy_n(oldStore.z.begin() + range.offset, keep, store.z.begin() + offset);
+                std::copy_n(oldStore.colors.begin() + range.offset, keep, store.colors.begin() + offset);
+            }
+            //fixtures that kept all their pixels keep their bounds
+            if(entry.bounds && (!b_kept || range.count != entry.count)) entry.bounds->b_dirty = true;
+            range.offset = offset;
+            range.count = entry.count;
+            if(entry.count > 0) store.fixtureRanges.push_back({offset, entry.count, entry.fixture});
+            offset += entry.count;
+        }
+
+        oldStore = std::move(store);
+        markSpatialIndexDirty(patch, nullptr); //pixel indices moved
+        patch.remove<Patch::PixelStoreDirty>();
+        patch.add<Patch::DmxMapDirty>();     //fixture offsets moved
+        patch.add<Patch::RenderAreaDirty>(); //fixtures may have been removed
     });
 
 
-    w.system<Fixture::PixelData>("UpdateLinePixelPositions").with<Fixture::WithShape, Shape::Line>()
+    w.system<Fixture::PixelRange>("UpdateLinePixelPositions").with<Fixture::WithShape, Shape::Line>()
     .kind(flecs::PostLoad)
     .with<Fixture::PixelPositionsDirty>()
     .with<Fixture::Is>()
     .immediate()
-    .each([](flecs::entity fixture, Fixture::PixelData& pd) {
+    .each([](flecs::entity fixture, Fixture::PixelRange& pr) {
         const Shape::Line& line = fixture.get<Fixture::WithShape,Shape::Line>();
-        Fixture::setPixelPositions(pd,
+        flecs::entity patch = Fixture::getPatch(fixture);
+        auto& store = patch.get_mut<Patch::PixelStore>();
+        if(!Fixture::setPixelPositions(store, pr,
             [&](float range, int index, size_t count) -> glm::vec3{
                 glm::vec2 out = line.start + range * (line.end - line.start);
                 return glm::vec3(out.x, out.y, 0.0);
-        });
+        })) return;
+        markSpatialIndexDirty(patch, &pr); //before the fixture changes table and pr moves
+        if(auto* bounds = fixture.try_get_mut<Fixture::Bounds>()) bounds->b_dirty = true;
         fixture.remove<Fixture::PixelPositionsDirty>();
-        Fixture::getPatch(fixture).add<Patch::RenderAreaDirty>();
+        patch.add<Patch::RenderAreaDirty>();
     });
 
 
-    w.system<Fixture::PixelData>("UpdateCirclePixelPositions").with<Fixture::WithShape, Shape::Circle>()
+    w.system<Fixture::PixelRange>("UpdateCirclePixelPositions").with<Fixture::WithShape, Shape::Circle>()
     .kind(flecs::PostLoad)
     .with<Fixture::PixelPositionsDirty>()
     .with<Fixture::Is>()
     .immediate()
-    .each([](flecs::entity fixture, Fixture::PixelData& pd) {
+    .each([](flecs::entity fixture, Fixture::PixelRange& pr) {
         const Shape::Circle& circle = fixture.get<Fixture::WithShape,Shape::Circle>();
-        Fixture::setPixelPositions(pd,
+        flecs::entity patch = Fixture::getPatch(fixture);
+        auto& store = patch.get_mut<Patch::PixelStore>();
+        if(!Fixture::setPixelPositions(store, pr,
             [&](float range, int index, size_t count) -> glm::vec3{
                 float angle = float(index) / float(count) * M_PI * 2.0;
                 glm::vec2 out{
@@ -419,9 +947,11 @@ void App::import(flecs::world& w){
                     circle.center.y + sinf(angle) * circle.radius
                 };
                 return glm::vec3(out.x, out.y, 0.0);
-        });
+        })) return;
+        markSpatialIndexDirty(patch, &pr); //before the fixture changes table and pr moves
+        if(auto* bounds = fixture.try_get_mut<Fixture::Bounds>()) bounds->b_dirty = true;
         fixture.remove<Fixture::PixelPositionsDirty>();
-        Fixture::getPatch(fixture).add<Patch::RenderAreaDirty>();
+        patch.add<Patch::RenderAreaDirty>();
     });
 
 
@@ -430,130 +960,365 @@ void App::import(flecs::world& w){
     .with<Patch::Is>()
     .immediate()
     .each([](flecs::entity patch, Patch::RenderArea& ra){
-        glm::vec3 min(FLT_MAX);
-        glm::vec3 max(-FLT_MAX);
-        bool b_hasPixels = false;
-        Fixture::iterateWithPixelData(patch,
-            [&](flecs::entity fixture, Fixture::PixelData& pd){
-                for(auto& p : pd.positions){
-                    min = glm::min(min, p);
-                    max = glm::max(max, p);
-                    b_hasPixels = true;
+        //rescan only the fixtures whose pixels changed, the area itself is a reduction over the fixture bounds
+        const auto& store = patch.get<Patch::PixelStore>();
+        auto fixtureFolder = patch.target<Patch::FixtureFolder>();
+        bool b_empty = true;
+        glm::vec3 min, max;
+        if(fixtureFolder.is_valid()){
+            App::getQueries(patch.world()).fixtureBoundsInPatch
+            .set_var("parent", fixtureFolder)
+            .each([&](flecs::entity fixture, Fixture::Is, const Fixture::PixelRange& range, Fixture::Bounds& bounds){
+                if(range.count == 0 || range.offset + range.count > store.x.size()) return;
+                if(bounds.b_dirty){
+                    Render::findMinMax(store.x.data() + range.offset, range.count, bounds.min.x, bounds.max.x);
+                    Render::findMinMax(store.y.data() + range.offset, range.count, bounds.min.y, bounds.max.y);
+                    Render::findMinMax(store.z.data() + range.offset, range.count, bounds.min.z, bounds.max.z);
+                    bounds.b_dirty = false;
                 }
-        });
-        if(b_hasPixels){
+                min = b_empty ? bounds.min : glm::min(min, bounds.min);
+                max = b_empty ? bounds.max : glm::max(max, bounds.max);
+                b_empty = false;
+            });
+        }
+        if(!b_empty){
             ra.min = min;
             ra.max = max;
         }
         patch.remove<Patch::RenderAreaDirty>();
+        if(patch.has<Patch::SampleMap>()) patch.add<Patch::SampleMapDirty>(); //pixels moved or the area changed
     });
 
 
+    //every position or render area change ends up here through RenderAreaDirty
+    //the map keeps the frame size of the last video frame, it is built on the first frame when none was seen yet
+    w.system<Patch::SampleMap, const Patch::PixelStore, const Patch::RenderArea>("UpdateSampleMap").with<Patch::SampleMapDirty>()
+    .kind(flecs::PreUpdate)
+    .with<Patch::Is>()
+    .immediate()
+    .each([](flecs::entity patch, Patch::SampleMap& map, const Patch::PixelStore& store, const Patch::RenderArea& area){
+        if(map.width > 0 && map.height > 0) rebuildSampleMap(map, store, area, map.width, map.height);
+        patch.remove<Patch::SampleMapDirty>();
+    });
+
+
+    w.system<Patch::SpatialIndex, const Patch::PixelStore>("UpdateSpatialIndex").with<Patch::SpatialIndexDirty>()
+    .kind(flecs::PreUpdate)
+    .with<Patch::Is>()
+    .immediate()
+    .each([](flecs::entity patch, Patch::SpatialIndex& index, const Patch::PixelStore& store){
+        if(index.b_rebuild || index.pixelCell.size() != store.x.size()) Render::rebuildSpatialIndex(index, store);
+        else{
+            for(auto [begin, end] : index.dirtyRanges) Render::updateSpatialIndex(index, store, begin, end);
+        }
+        index.dirtyRanges.clear();
+        index.b_rebuild = false;
+        patch.remove<Patch::SpatialIndexDirty>();
+    });
+
+
+    //recompute the universes and copy spans of the fixtures whose address or layout changed
+    w.system<Fixture::Layout, Fixture::DmxAddress>("UpdateFixtureDmxMap").with<Fixture::DmxMapDirty>()
+    .kind(flecs::PreUpdate)
+    .with<Fixture::Is>()
+    .immediate()
+    .each([](flecs::entity fixture, Fixture::Layout& l, Fixture::DmxAddress& a){
+        //copies, the references are invalidated when the fixture changes table below
+        const Fixture::Layout layout = l;
+        const Fixture::DmxAddress dmxAddress = a;
+
+        flecs::entity patch = Fixture::getPatch(fixture);
+        if(!patch.is_valid() || !patch.has<Patch::DmxUniverseMap>()){
+            fixture.remove<Fixture::DmxMapDirty>();
+            return;
+        }
+
+        int channels = dmxAddress.address + layout.pixelCount * layout.channelsPerPixel;
+        Fixture::UniverseSpan newSpan{
+            .first = dmxAddress.universe,
+            .count = uint16_t((channels + 511) / 512)
+        };
+        Fixture::UniverseSpan oldSpan{0, 0};
+        if(const auto* span = fixture.try_get<Fixture::UniverseSpan>()) oldSpan = *span;
+
+        if(oldSpan.first != newSpan.first || oldSpan.count != newSpan.count){
+            //acquire before releasing so universes shared by both spans are never destroyed and recreated
+            fixture.remove<Fixture::InUniverse>(flecs::Wildcard);
+            for(int i = 0; i < newSpan.count; i++){
+                flecs::entity universe = Artnet::Universe::acquire(patch, newSpan.first + i);
+                if(universe.is_valid()) fixture.add<Fixture::InUniverse>(universe);
+            }
+            for(int i = 0; i < oldSpan.count; i++) Artnet::Universe::release(patch, oldSpan.first + i);
+            fixture.set<Fixture::UniverseSpan>(newSpan);
+        }
+
+        Fixture::CopySpans copySpans;
+        const auto* pixelRange = fixture.try_get<Fixture::PixelRange>();
+        const auto* channelFormat = fixture.try_get<Fixture::ChannelFormat>();
+        const Artnet::PackFormat& packFormat = channelFormat ?
+            Artnet::getPackFormat(channelFormat->order) :
+            Artnet::getDefaultPackFormat(layout.channelsPerPixel);
+        if(pixelRange && (int)pixelRange->count >= layout.pixelCount && packFormat.channelCount == layout.channelsPerPixel){
+            const auto& universes = patch.get<Patch::DmxUniverseMap>().universes;
+            Artnet::compileFixtureSpans(
+                copySpans.spans,
+                layout.pixelCount,
+                packFormat,
+                dmxAddress.universe,
+                dmxAddress.address,
+                [&](uint16_t universeId) -> uint8_t* {
+                    auto it = universes.find(universeId);
+                    if(it == universes.end()) return nullptr;
+                    return it->second.get_mut<Artnet::Universe::Channels>().channels;
+                });
+        }
+        fixture.set<Fixture::CopySpans>(copySpans);
+
+        fixture.remove<Fixture::DmxMapDirty>();
+        markDmxUniversesDirty(patch, oldSpan);
+        markDmxUniversesDirty(patch, newSpan);
+    });
+
+
+    //concatenate the fixture spans into the flat per frame copy plan, after the pixel store or the devices changed
     w.system<Patch::Is>("UpdateDmxOutputMap").with<Patch::DmxMapDirty>()
     .kind(flecs::PreUpdate)
     .immediate()
     .each([](flecs::entity patch, Patch::Is){
 
-        std::unordered_map<uint16_t, flecs::entity> univsByNumber;
-        std::unordered_map<flecs::entity, std::vector<uint16_t>, EntityHasher> univsByFixture;
+        //used sizes are recomputed from scratch, the routes only follow when one of them changed
+        const auto& universes = patch.get<Patch::DmxUniverseMap>().universes;
+        std::vector<uint16_t> previousUsedSizes;
+        for(auto& [id, universe] : universes){
+            auto& properties = universe.get_mut<Artnet::Universe::Properties>();
+            previousUsedSizes.push_back(properties.usedSize);
+            properties.usedSize = 0;
+        }
 
-        //compile a list of universes that are needed to cover all fixtures
+        std::vector<Artnet::CopySpan> spans;
         Fixture::iterateWithDmx(patch,
-            [&](flecs::entity fixture, Fixture::Layout& layout, Fixture::DmxAddress dmxAddress){
-                int fixtureUniverseCount = 1;
-                int channels = dmxAddress.address + layout.pixelCount * layout.channelsPerPixel;
-                while(channels > 512){ fixtureUniverseCount++; channels -= 512; }
-                
-                auto& fixtureUnivNumbers = univsByFixture[fixture];
-                for(int i = 0; i < fixtureUniverseCount; i++){
-                    univsByNumber[dmxAddress.universe + i] = flecs::entity::null();
-                    fixtureUnivNumbers.push_back(dmxAddress.universe + i);
+            [&](flecs::entity fixture, Fixture::Layout& layout, Fixture::DmxAddress& dmxAddress){
+                const auto* copySpans = fixture.try_get<Fixture::CopySpans>();
+                const auto* pixelRange = fixture.try_get<Fixture::PixelRange>();
+                if(!copySpans || !pixelRange) return;
+                for(Artnet::CopySpan span : copySpans->spans){
+                    span.source += pixelRange->offset;
+                    spans.push_back(span);
                 }
-        });
 
-        //compare with the current list of universes, decide what to keep and delete
-        std::vector<flecs::entity> toDelete;
-        Artnet::Universe::iterate(patch,
-            [&](flecs::entity universe, Artnet::Universe::Properties& properties){
-                //if not in new list, mark for deletion
-                if(univsByNumber.count(properties.universeId) == 0)
-                    toDelete.push_back(universe);
-                //else store in map
-                else univsByNumber[properties.universeId] = universe;
+                //used size of every universe is the furthest channel written by any fixture
+                int end = dmxAddress.address + layout.pixelCount * layout.channelsPerPixel;
+                int universeCount = (end + 511) / 512;
+                for(int i = 0; i < universeCount; i++){
+                    auto it = universes.find(dmxAddress.universe + i);
+                    if(it == universes.end()) continue;
+                    uint16_t used = i == universeCount - 1 ? uint16_t(end - i * 512) : 512;
+                    auto& properties = it->second.get_mut<Artnet::Universe::Properties>();
+                    properties.usedSize = std::max(properties.usedSize, used);
+                }
         });
-        
-        //Delete and add universes
-        for (auto e : toDelete) e.destruct();
-        for(auto& [id, universe] : univsByNumber){
-            if(!universe.is_valid()){
-                flecs::entity newUniverse = Artnet::Universe::create(patch, id);
-                if(newUniverse.is_valid()) universe = newUniverse;
-            }
+        //grouped by universe so UpdateDmxUniverses can replace the spans of single universes
+        std::sort(spans.begin(), spans.end(), isBeforeInPlan);
+
+        bool b_routingChanged = patch.has<Patch::DmxRoutingDirty>();
+        size_t index = 0;
+        for(auto& [id, universe] : universes){
+            if(universe.get<Artnet::Universe::Properties>().usedSize != previousUsedSizes[index++]) b_routingChanged = true;
         }
 
-        //Rebuild Fixture-InUniverse relationships
-        for(const auto& [fixture, univList] : univsByFixture){
-            fixture.remove<Fixture::InUniverse>(flecs::Wildcard);
-            for(auto id : univList){
-                fixture.add<Fixture::InUniverse>(univsByNumber[id]);
+        auto& plan = patch.get_mut<Artnet::OutputPlan>();
+        plan.spans = std::move(spans);
+        plan.dirtyUniverses.clear(); //covered by the full rebuild
+        if(b_routingChanged) Artnet::Universe::updateRouting(patch);
+
+        patch.remove<Patch::DmxUniversesDirty>();
+        patch.remove<Patch::DmxRoutingDirty>();
+        patch.remove<Patch::DmxMapDirty>();
+    });
+
+
+    //a fixture moved or changed its format: only the universes it left or entered get new spans and used sizes,
+    //the rest of the plan is kept and the routes are only rebuilt when a universe appeared, vanished or changed length
+    w.system<Artnet::OutputPlan>("UpdateDmxUniverses").with<Patch::DmxUniversesDirty>()
+    .kind(flecs::PreUpdate)
+    .with<Patch::Is>()
+    .immediate()
+    .each([](flecs::entity patch, Artnet::OutputPlan& plan){
+        std::vector<uint16_t> dirty = std::move(plan.dirtyUniverses);
+        plan.dirtyUniverses.clear();
+        std::sort(dirty.begin(), dirty.end());
+        dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+        std::erase_if(plan.spans, [&](const Artnet::CopySpan& span){
+            return std::binary_search(dirty.begin(), dirty.end(), span.universeId);
+        });
+
+        const auto& universes = patch.get<Patch::DmxUniverseMap>().universes;
+        bool b_routingChanged = patch.has<Patch::DmxRoutingDirty>();
+        std::vector<Artnet::CopySpan> spans;
+        for(uint16_t universeId : dirty){
+            auto it = universes.find(universeId);
+            if(it == universes.end()) continue; //released, its spans went with it
+            uint16_t usedSize = 0;
+            Fixture::iterateInDmxUniverse(patch, it->second,
+                [&](flecs::entity fixture, Fixture::Layout& layout, Fixture::DmxAddress& dmxAddress){
+                    const auto* copySpans = fixture.try_get<Fixture::CopySpans>();
+                    const auto* pixelRange = fixture.try_get<Fixture::PixelRange>();
+                    if(!copySpans || !pixelRange) return;
+                    for(Artnet::CopySpan span : copySpans->spans){
+                        if(span.universeId != universeId) continue;
+                        span.source += pixelRange->offset;
+                        spans.push_back(span);
+                    }
+                    int end = dmxAddress.address + layout.pixelCount * layout.channelsPerPixel - (universeId - dmxAddress.universe) * 512;
+                    usedSize = std::max(usedSize, uint16_t(std::clamp(end, 0, 512)));
+            });
+            auto& properties = it->second.get_mut<Artnet::Universe::Properties>();
+            if(properties.usedSize != usedSize){
+                properties.usedSize = usedSize;
+                b_routingChanged = true;
             }
         }
 
-        patch.remove<Patch::DmxMapDirty>();
+        //the fixtures of a universe come in query order, sorted like the full rebuild, then merged since the lists share no universe
+        std::sort(spans.begin(), spans.end(), isBeforeInPlan);
+        std::vector<Artnet::CopySpan> merged;
+        merged.reserve(plan.spans.size() + spans.size());
+        std::merge(plan.spans.begin(), plan.spans.end(), spans.begin(), spans.end(), std::back_inserter(merged), isBeforeInPlan);
+        plan.spans = std::move(merged);
+        if(b_routingChanged) Artnet::Universe::updateRouting(patch);
+
+        patch.remove<Patch::DmxRoutingDirty>();
+        patch.remove<Patch::DmxUniversesDirty>();
     });
 
-    w.system<>("TestRender")
+    //effect graphs of all active patches without video input
+    w.system<>("RenderEffects")
     .kind(flecs::OnUpdate)
     .immediate()
     .run([](flecs::iter& it){
-        flecs::entity app = get(it.world());
-        flecs::entity selectedPatch = Patch::getSelected(app);
-        const auto& renderArea = selectedPatch.get<Patch::RenderArea>();
-        glm::vec3 center = (renderArea.max + renderArea.min) * 0.5f;
-        float time = ImGui::GetTime();
-        Fixture::iterateWithPixelData(selectedPatch,
-            [&](flecs::entity fixture, Fixture::PixelData& pixelData){
-                if(pixelData.colors.size() != pixelData.positions.size()) return;
-                for(int i = 0; i < pixelData.positions.size(); i++){
-                    const auto& pos = pixelData.positions[i];
-                    float dist = glm::distance(pos, center);
-                    float br = std::sin((dist - time * 100.0) / 30.0);
-                    uint8_t out = br > 0 ? br * 255.0 : 0;
-                    pixelData.colors[i] = ColorRGBW{
-                        .r = out,
-                        .g = out,
-                        .b = out,
-                        .w = out
-                    };
+        //the chunks of all patches are rendered in one parallel loop, so small patches don't leave workers idle
+        struct RenderJob{
+            Render::EffectGraph* graph;
+            Patch::PixelStore* store;
+            glm::vec3 center;
+            size_t firstChunk;
+        };
+        std::vector<RenderJob> jobs;
+        size_t chunkCount = 0;
+        Patch::iterateActive(get(it.world()), [&](flecs::entity patch){
+            if(patch.has<Patch::VideoInput>()) return;
+            const auto* effect = patch.try_get<Patch::Effect>();
+            if(!effect || !effect->graph) return;
+            //structure changes recompile here, once, failed graphs render nothing until they are edited again
+            if(effect->graph->needsCompile() && !effect->graph->compile()){
+                std::cout << "Could not compile the effect of " << patch.name() << std::endl;
+            }
+            const auto& renderArea = patch.get<Patch::RenderArea>();
+            auto& store = patch.get_mut<Patch::PixelStore>();
+            if(store.colors.empty()) return;
+            jobs.push_back(RenderJob{
+                .graph = effect->graph.get(),
+                .store = &store,
+                .center = (renderArea.max + renderArea.min) * 0.5f,
+                .firstChunk = chunkCount
+            });
+            chunkCount += (store.colors.size() + RenderChunkSize - 1) / RenderChunkSize;
+        });
+        //world time so rendering doesn't depend on the gui clock, headless runs animate the same way
+        float time = it.world().get_info()->world_time_total;
+        //pixel ranges are independent, split the stores in fixed chunks across the worker threads
+        ThreadPool::getShared().parallelFor(chunkCount, 1,
+            [&](size_t beginChunk, size_t endChunk){
+                for(size_t chunk = beginChunk; chunk < endChunk; chunk++){
+                    auto job = std::prev(std::upper_bound(jobs.begin(), jobs.end(), chunk,
+                        [](size_t chunk, const RenderJob& job){ return chunk < job.firstChunk; }));
+                    size_t begin = (chunk - job->firstChunk) * RenderChunkSize;
+                    job->graph->render(*job->store, job->center, time, begin, begin + RenderChunkSize);
                 }
         });
     });
 
+    //video content is a pure gather through the cached sample map
+    w.system<Patch::VideoInput, Patch::SampleMap, Patch::PixelStore, const Patch::RenderArea>("RenderVideoInput")
+    .kind(flecs::OnUpdate)
+    .with<Patch::Is>()
+    .immediate()
+    .each([](flecs::entity patch, Patch::VideoInput& input, Patch::SampleMap& map, Patch::PixelStore& store, const Patch::RenderArea& area){
+        if(!Patch::isActive(patch)) return;
+        Render::Frame frame;
+        if(!input.source || !input.source->nextFrame(frame)) return;
+        //the frame size is only known here, a new size invalidates every texel index
+        if(map.width != frame.width || map.height != frame.height || map.index.size() != store.colors.size()){
+            rebuildSampleMap(map, store, area, frame.width, frame.height);
+        }
+        input.samples.resize(store.colors.size());
+        ThreadPool::getShared().parallelFor(input.samples.size(), RenderChunkSize,
+            [&](size_t begin, size_t end){
+                Render::sampleFrame(map, frame, input.samples.data(), begin, end);
+        });
+        //a producer that lapped the ring while we read leaves a torn frame, the patch keeps its previous colors then
+        if(input.source->finishFrame()){
+            std::swap(store.colors, input.samples);
+            input.publishTime = input.source->getPublishTime();
+        }
+    });
+
+    //channels the output plan doesn't cover must not keep the merged values of the last frame
+    w.system<>("RestoreArtnetInput")
+    .kind(flecs::OnValidate)
+    .immediate()
+    .run([](flecs::iter& it) {
+        Patch::iterateActive(get(it.world()), [](flecs::entity patch){
+            const auto* input = patch.try_get<Patch::ArtnetInput>();
+            if(!input || !input->engine) return;
+            Artnet::Universe::iterate(patch, [&](flecs::entity universe, Artnet::Universe::Properties& properties){
+                input->engine->restorePixels(properties.universeId, universe.get_mut<Artnet::Universe::Channels>().channels);
+            });
+        });
+    });
+
+    //patches write into their own universes only, so their plans run in parallel
     w.system<>("WriteArtnetOutput")
     .kind(flecs::OnValidate)
     .immediate()
     .run([](flecs::iter& it) {
-        flecs::entity app = get(it.world());
-        flecs::entity selectedPatch = Patch::getSelected(app);
-        Fixture::iterateWithDmx(selectedPatch,
-            [&](flecs::entity fixture, Fixture::Layout& l, Fixture::DmxAddress& a){
-                int startUniverse = a.universe;
-                int startAddress = a.address;
-                const auto& pixelData = fixture.get<Fixture::PixelData>();
-
-                fixture.each<Fixture::InUniverse>(
-                    [&](flecs::entity universe){
-                        auto* channels = universe.try_get_mut<Artnet::Universe::Channels>();
-                        const auto* props = universe.try_get<Artnet::Universe::Properties>();
-                        if(!channels || !props) return;
-                        Fixture::writeColorsToUniverse(
-                            pixelData.colors,
-                            channels->channels,
-                            props->universeId,
-                            startUniverse,
-                            startAddress,
-                            l.channelsPerPixel);
-                });
+        std::vector<std::pair<const Artnet::OutputPlan*, const ColorRGBW*>> plans;
+        Patch::iterateActive(get(it.world()), [&](flecs::entity patch){
+            const auto* plan = patch.try_get<Artnet::OutputPlan>();
+            const auto* store = patch.try_get<Patch::PixelStore>();
+            if(plan && store) plans.push_back({plan, store->colors.data()});
+        });
+        ThreadPool::getShared().parallelFor(plans.size(), 1,
+            [&](size_t begin, size_t end){
+                for(size_t i = begin; i < end; i++) Artnet::executeOutputPlan(*plans[i].first, plans[i].second);
+        });
+    });
+
+    w.system<>("MergeArtnetInput")
+    .kind(flecs::OnValidate)
+    .immediate()
+    .run([](flecs::iter& it) {
+        Patch::iterateActive(get(it.world()), [](flecs::entity patch){
+            const auto* input = patch.try_get<Patch::ArtnetInput>();
+            if(!input || !input->engine) return;
+            Artnet::Universe::iterate(patch, [&](flecs::entity universe, Artnet::Universe::Properties& properties){
+                input->engine->merge(properties.universeId, universe.get_mut<Artnet::Universe::Channels>().channels, input->mode);
+            });
+        });
+    });
+
+    //hands the frames to the output threads, the actual sending is timed by each engine
+    //video frames carry the time their producer published them, so the engine can measure producer to wire latency
+    w.system<>("PublishArtnetOutput")
+    .kind(flecs::PostUpdate)
+    .immediate()
+    .run([](flecs::iter& it) {
+        Patch::iterateActive(get(it.world()), [](flecs::entity patch){
+            const auto* output = patch.try_get<Patch::ArtnetOutput>();
+            if(!output || !output->engine) return;
+            const auto* video = patch.try_get<Patch::VideoInput>();
+            output->engine->publish(video ? video->publishTime : 0);
         });
     });
 
@@ -576,4 +1341,33 @@ void App::import(flecs::world& w){
 
 };//App::Import()
 
+
+void App::createDemo(flecs::entity app){
+    auto patch1 = Patch::create(app);
+    auto f1 = Fixture::createLine(patch1, glm::vec2(100.0, 200.0), glm::vec2(200.0, 100.0), 16, 4);
+    auto f2 = Fixture::createCircle(patch1, glm::vec2(100.0, 100.0), 50.0, 32, 3);
+    Fixture::setDmxProperties(f1, 0, 0);
+    Fixture::setDmxProperties(f2, 0, 64);
+    Artnet::Device::create(patch1, Artnet::Device::makeIpAddress(127, 0, 0, 1), 0, 16);
+    auto patch2 = Patch::create(app);
+    Patch::select(app, patch1);
+    int bytes = 0;
+    int channelCount = 3;
+    std::vector<Shape::Circle> circles;
+    std::vector<Fixture::Layout> layouts;
+    std::vector<Fixture::DmxAddress> addresses;
+    for(int i = 0; i < 8; i++){
+        for(int j = 0; j < 8; j++){
+            int pixelCount = random() % 16 + 6;
+            int fixtureBytes = pixelCount * channelCount;
+            circles.push_back({glm::vec2(i*100.0 + 50.0, j*100.0 + 50), 45.0f});
+            layouts.push_back({pixelCount, channelCount});
+            addresses.push_back({uint16_t(bytes / 512), uint16_t(bytes % 512)});
+            bytes += fixtureBytes;
+        }
+    }
+    Fixture::createCircles(patch2, circles, layouts, addresses);
+    patch2.set<Patch::Effect>({std::make_shared<Render::EffectGraph>(Render::createLayeredEffect())});
+}
+
 };//namespace PixelMapper
\ No newline at end of file
@@ -1,18 +1,49 @@
 #pragma once
 
 #include <stdint.h>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
 #include <glm/glm.hpp>
 #include <flecs.h>
 
 
 namespace PixelMapper{
 
+namespace Artnet{
+    class OutputEngine;
+    class InputEngine;
+
+    //how received art-net is combined with the pixel channels of a universe
+    enum class MergeMode : uint8_t{
+        HTP,        //highest value per channel
+        LTP,        //latest change per channel
+        Priority,   //input replaces the whole universe while a source is live
+        Count
+    };
+    const char* getMergeModeName(MergeMode mode);
+}
+namespace Render{
+    class FrameSource;
+    class EffectGraph;
+}
+
+struct ColorRGBW{
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    uint8_t w = 0;
+};
+
 namespace App{
     struct Is{};
     struct PatchFolder{};
     struct SelectedPatch{};
     void import(flecs::world& w);
     flecs::entity get(const flecs::world& w);
+    //two demo patches, the first one selected and routed to localhost
+    void createDemo(flecs::entity app);
 }
 
 namespace Gui{
@@ -24,34 +55,104 @@ namespace Patch{
 
     struct FixtureFolder{};
     struct DmxUniverseFolder{};
+    struct DeviceFolder{};
 
     struct SelectedFixture{};
     struct SelectedDmxUniverse{};
 
     struct DmxMapDirty{};
+    struct DmxUniversesDirty{};     //only the universes queued in Artnet::OutputPlan::dirtyUniverses changed
+    struct DmxRoutingDirty{};
     struct RenderAreaDirty{};
+    struct PixelStoreDirty{};
+    struct SampleMapDirty{};
+    struct SpatialIndexDirty{};
 
     struct Settings{
         float refreshRate;
+        float keepAliveInterval = 1.0f;    //seconds between resends of an unchanged universe, 0 sends every universe every frame
+        bool b_active = true;               //inactive patches are neither rendered nor sent
     };
     struct RenderArea{
         glm::vec3 min;
         glm::vec3 max;
     };
+    //pixels of all fixtures in the patch, stored contiguously as structure of arrays
+    //each fixture owns the range described by its Fixture::PixelRange
+    struct PixelStore{
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<ColorRGBW> colors;
+        //range of every fixture with pixels in offset order, rebuilt with the ranges by UpdatePixelStore
+        //so a pixel finds its fixture with a binary search, see Fixture::findByPixel()
+        struct FixtureRange{
+            uint32_t offset;
+            uint32_t count;
+            flecs::entity fixture;
+        };
+        std::vector<FixtureRange> fixtureRanges;
+    };
+    struct ArtnetOutput{
+        std::shared_ptr<Artnet::OutputEngine> engine;
+    };
+    //optional, merges art-net received on UdpPort into the patch universes
+    //only one patch should receive at a time, they would share the port
+    struct ArtnetInput{
+        std::shared_ptr<Artnet::InputEngine> engine;
+        Artnet::MergeMode mode = Artnet::MergeMode::HTP;
+    };
+    //optional, patches with a video input sample their colors from its frames instead of the effect
+    struct VideoInput{
+        std::shared_ptr<Render::FrameSource> source;
+        std::vector<ColorRGBW> samples;     //the frame is sampled here and only swapped into the store if it wasn't torn
+        int64_t publishTime = 0;            //of the frame in the store by its producer, see FrameSource::getPublishTime()
+    };
+    //effect graph rendering the patch colors, see render/EffectGraph.h
+    //the graph is recompiled by RenderEffects after structural changes, parameters can be changed any time on the ecs thread
+    struct Effect{
+        std::shared_ptr<Render::EffectGraph> graph;
+    };
+    //bilinear lookup of every PixelStore pixel into frames of width x height, see render/Sampler.h
+    //structure of arrays like the store, rebuilt by UpdateSampleMap only when pixels move or the render area changes
+    struct SampleMap{
+        int width = 0;
+        int height = 0;
+        uint32_t strideX = 0;           //offset to the right and bottom texels, 0 on single texel edges
+        uint32_t strideY = 0;
+        std::vector<uint32_t> index;    //top left texel
+        std::vector<float> fx;          //weights of the right and bottom texels
+        std::vector<float> fy;
+    };
+    //uniform grid over the pixel positions (x, y) for picking, rubber band selection and culling, see render/SpatialIndex.h
+    //cells are hashed so the canvas stays unbounded, every pixel knows its cell and slot so moving a fixture
+    //only touches its own pixels. UpdateSpatialIndex applies the queued ranges, or rebuilds when the store was reassigned
+    struct SpatialIndex{
+        float cellSize = 32.0f;
+        std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+        std::vector<uint64_t> pixelCell;
+        std::vector<uint32_t> pixelSlot;
+        std::vector<std::pair<uint32_t, uint32_t>> dirtyRanges; //[begin, end) pixels that moved
+        bool b_rebuild = true;
+    };
+    //universe entities by id, each universe is reference counted by the fixtures that write into it
+    struct DmxUniverseMap{
+        std::unordered_map<uint16_t, flecs::entity> universes;
+    };
 
     flecs::entity create(flecs::entity pixelMapper);
     void select(flecs::entity pixelMapper, flecs::entity patch);
     flecs::entity getSelected(flecs::entity pixelMapper);
 
     int getCount(flecs::entity pixelMapper);
-    void iterate(flecs::entity pixelMapper, std::function<void(flecs::entity patch)> fn);
-};
 
-struct ColorRGBW{
-    uint8_t r = 0;
-    uint8_t g = 0;
-    uint8_t b = 0;
-    uint8_t w = 0;
+    //starts receiving or just changes the merge mode when already receiving
+    void enableArtnetInput(flecs::entity patch, Artnet::MergeMode mode);
+    void disableArtnetInput(flecs::entity patch);
+    void iterate(flecs::entity pixelMapper, std::function<void(flecs::entity patch)> fn);
+    //every patch is rendered and sent each frame unless deactivated, the selection only drives the gui
+    bool isActive(flecs::entity patch);
+    void iterateActive(flecs::entity pixelMapper, std::function<void(flecs::entity patch)> fn);
 };
 
 namespace Fixture{
@@ -62,24 +163,55 @@ namespace Fixture{
 
     struct LayoutDirty{};
     struct PixelPositionsDirty{};
+    struct DmxMapDirty{};
 
     struct Layout{
         int pixelCount;
         int channelsPerPixel;
     };
+
+    //order of the dmx channels of one pixel, 16 suffixed orders use two channels (coarse, fine) per color
+    enum class ChannelOrder : uint8_t{
+        R, RG,
+        RGB, RBG, GRB, GBR, BRG, BGR,
+        RGBW, GRBW, WRGB,
+        RGB16, GRB16, RGBW16,
+        Count
+    };
+    //optional, without it a fixture emits the first channelsPerPixel bytes of each color in rgbw order
+    struct ChannelFormat{
+        ChannelOrder order;
+    };
+
+    int getChannelCount(ChannelOrder order);
+    const char* getChannelOrderName(ChannelOrder order);
     struct DmxAddress{
         uint16_t universe;
         uint16_t address;
     };
-    struct PixelData{
-        std::vector<glm::vec3> positions;
-        std::vector<ColorRGBW> colors;
+    //range of the fixture pixels inside the patch Patch::PixelStore
+    struct PixelRange{
+        uint32_t offset;
+        uint32_t count;
+    };
+    //extent of the fixture pixels, the patch Patch::RenderArea is the union of all fixture bounds
+    //only dirty bounds are rescanned from the PixelStore by UpdateRenderArea
+    struct Bounds{
+        glm::vec3 min;
+        glm::vec3 max;
+        bool b_dirty = true;
     };
 
     void select(flecs::entity patch, flecs::entity fixture);
     flecs::entity getSelected(flecs::entity patch);
+    //fixture whose PixelRange contains the pixel, null if none
+    flecs::entity findByPixel(flecs::entity patch, uint32_t pixel);
+    //fixture owning the most of the pixels (sorted ascending), null if none
+    flecs::entity findByMostPixels(flecs::entity patch, const std::vector<uint32_t>& sortedPixels);
     void clearSelection(flecs::entity patch);
 
+    //bare fixture without shape or name, used by the patch file loaders
+    flecs::entity create(flecs::entity patch, int numPixels, int channelsPerPixel);
     flecs::entity createLine(flecs::entity patch, glm::vec2 start, glm::vec2 end, int numPixels = 16, int channelsPerPixel = 4);
     flecs::entity createCircle(flecs::entity patch, glm::vec2 center, float radius, int numPixels = 16, int channelsPerPixel = 4);
     
@@ -88,7 +220,7 @@ namespace Fixture{
     int getCountWithDmx(flecs::entity patch);
     void iterateWithDmx(flecs::entity patch, std::function<void(flecs::entity fixture, Fixture::Layout&, Fixture::DmxAddress&)> fn);
     void iterateInDmxUniverse(flecs::entity patch, flecs::entity universe, std::function<void(flecs::entity fixture, Fixture::Layout&, Fixture::DmxAddress&)> fn);
-    void iterateWithPixelData(flecs::entity patch, std::function<void(flecs::entity fixture, Fixture::PixelData&)> fn);
+    void iterateWithPixelRange(flecs::entity patch, std::function<void(flecs::entity fixture, Fixture::PixelRange&)> fn);
 };
 
 
@@ -100,6 +232,7 @@ namespace Artnet::Universe{
     struct Properties{
         uint16_t universeId;
         uint16_t usedSize;
+        uint32_t referenceCount = 0;
     };
     struct Channels{
         uint8_t channels[512];
@@ -108,6 +241,10 @@ namespace Artnet::Universe{
     flecs::entity getSelected(flecs::entity patch);
     void select(flecs::entity patch, flecs::entity universe);
 
+    //get or create the universe and add a reference, release removes it and destroys the universe once unused
+    flecs::entity acquire(flecs::entity patch, uint16_t universeId);
+    void release(flecs::entity patch, uint16_t universeId);
+
     void iterate(flecs::entity patch, std::function<void(flecs::entity dmxUniverse, Artnet::Universe::Properties&)> fn);
 };
 
@@ -119,6 +256,58 @@ namespace Artnet::Device{
     struct IpAddress{
         uint32_t address;
     };
+    struct UniverseRange{
+        uint16_t first;
+        uint16_t count;
+    };
+    //optional, devices without options use the defaults
+    struct Options{
+        bool b_sync = true;     //send ArtSync after each frame so the node outputs all its universes at once
+    };
+
+    constexpr uint32_t makeIpAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d){
+        return (uint32_t(a) << 24) | (uint32_t(b) << 16) | (uint32_t(c) << 8) | uint32_t(d);
+    }
+
+    flecs::entity create(flecs::entity patch, uint32_t ipAddress, uint16_t firstUniverse, uint16_t universeCount);
+    flecs::entity findForUniverse(flecs::entity patch, uint16_t universeId);
+    bool isSyncEnabled(flecs::entity device);
+
+    void iterate(flecs::entity patch, std::function<void(flecs::entity device, Artnet::Device::IpAddress&, Artnet::Device::UniverseRange&)> fn);
+};
+
+namespace Artnet{
+    struct PackFormat;
+
+    //contiguous run of pixels packed into one universe buffer
+    //a span with firstChannel != 0 or a short byteCount is a single pixel split across a universe boundary
+    struct CopySpan{
+        uint32_t source;            //first pixel, relative to the fixture in Fixture::CopySpans, to the patch PixelStore in OutputPlan
+        uint16_t universeId;        //of the destination
+        uint8_t* destination;
+        uint32_t pixelCount;
+        uint16_t firstChannel;
+        uint16_t byteCount;
+        const PackFormat* format;
+    };
+    //flat list of all copy spans of a patch sorted by universe then source pixel, compiled by UpdateDmxOutputMap
+    //a fixture that only changed its own spans queues its universes, UpdateDmxUniverses then redoes just those
+    struct OutputPlan{
+        std::vector<CopySpan> spans;
+        std::vector<uint16_t> dirtyUniverses;
+    };
+};
+
+namespace Fixture{
+    //universes currently referenced by the fixture
+    struct UniverseSpan{
+        uint16_t first;
+        uint16_t count;
+    };
+    //copy spans of one fixture, concatenated into the patch Artnet::OutputPlan
+    struct CopySpans{
+        std::vector<Artnet::CopySpan> spans;
+    };
 };
 
 
@@ -133,5 +322,13 @@ namespace Shape{
     };
 };
 
+namespace Fixture{
+    //bulk creation, element i of each array describes fixture i, all arrays must have the same size
+    //entities are created directly in their final table and named without re-counting the patch,
+    //the layout & dmx dirty state is resolved in one pass on the next frame
+    std::vector<flecs::entity> createLines(flecs::entity patch, std::span<const Shape::Line> lines, std::span<const Layout> layouts, std::span<const DmxAddress> addresses);
+    std::vector<flecs::entity> createCircles(flecs::entity patch, std::span<const Shape::Circle> circles, std::span<const Layout> layouts, std::span<const DmxAddress> addresses);
+};
+
 
 }//namespace PixelMapper
\ No newline at end of file
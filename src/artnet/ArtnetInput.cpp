@@ -0,0 +1,170 @@
+#include "ArtnetInput.h"
+#include "DmxMerge.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace PixelMapper::Artnet{
+
+InputEngine::InputEngine(uint16_t port) : socket(ioContext) {
+    asio::error_code error;
+    socket.open(asio::ip::udp::v4(), error);
+    if(error){
+        std::cout << "Could not open Art-Net input socket: " << error.message() << std::endl;
+        return;
+    }
+    //other art-net software on this machine may listen on the same port
+    socket.set_option(asio::socket_base::reuse_address(true), error);
+    //a console sends all its universes as one burst, don't let the kernel drop the tail of it
+    socket.set_option(asio::socket_base::receive_buffer_size(4 * 1024 * 1024), error);
+    socket.bind(asio::ip::udp::endpoint(asio::ip::address_v4::any(), port), error);
+    if(error){
+        std::cout << "Could not bind Art-Net input to port " << port << ": " << error.message() << std::endl;
+        socket.close(error);
+        return;
+    }
+
+    receive();
+    thread = std::thread([this](){ ioContext.run(); });
+}
+
+InputEngine::~InputEngine(){
+    ioContext.stop();
+    if(thread.joinable()) thread.join();
+    asio::error_code error;
+    socket.close(error);
+}
+
+void InputEngine::setUniverses(const std::vector<uint16_t>& universeIds){
+    std::unordered_map<uint16_t, std::unique_ptr<UniverseInput>> newUniverses;
+    std::lock_guard<std::mutex> lock(mutex);
+    for(uint16_t id : universeIds){
+        auto it = universes.find(id);
+        if(it != universes.end()) newUniverses[id] = std::move(it->second);
+        else newUniverses[id] = std::make_unique<UniverseInput>();
+    }
+    universes = std::move(newUniverses);
+}
+
+void InputEngine::receive(){
+    socket.async_receive_from(asio::buffer(packet, sizeof(packet)), sender,
+        [this](const asio::error_code& error, size_t size){
+            if(error == asio::error::operation_aborted) return;
+            if(!error) handlePacket(size);
+            receive();
+    });
+}
+
+void InputEngine::handlePacket(size_t size){
+    if(size < DmxHeaderSize) return;
+    const char id[8] = {'A','r','t','-','N','e','t', 0};
+    if(std::memcmp(packet, id, 8) != 0) return;
+    uint16_t opCode = packet[8] | (packet[9] << 8);
+    if(opCode != OpDmx) return;
+    uint16_t ignored = ignoredPort.load(std::memory_order_relaxed);
+    if(ignored != 0 && sender.port() == ignored) return;
+
+    uint16_t universeId = packet[14] | ((packet[15] & 0x7F) << 8);
+    size_t length = std::min<size_t>((packet[16] << 8) | packet[17], DmxMaxLength);
+    if(length == 0 || size < DmxHeaderSize + length) return;
+
+    uint32_t ipAddress = sender.address().to_v4().to_uint();
+    Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = universes.find(universeId);
+    if(it == universes.end()) return;
+    UniverseInput& universe = *it->second;
+
+    //the known source, otherwise a free or timed out slot, a third live source is ignored
+    int slot = -1;
+    for(int i = 0; i < MaxSources; i++){
+        const Source& source = universe.sources[i];
+        if(source.b_active && source.ipAddress == ipAddress){ slot = i; break; }
+    }
+    for(int i = 0; i < MaxSources && slot < 0; i++){
+        const Source& source = universe.sources[i];
+        if(!source.b_active || now - source.lastReceived > SourceTimeout) slot = i;
+    }
+    if(slot < 0) return;
+
+    Source& source = universe.sources[slot];
+    source.ipAddress = ipAddress;
+    source.lastReceived = now;
+    source.b_active = true;
+    std::memcpy(source.channels, packet + DmxHeaderSize, length);
+    //a shorter packet leaves the remaining channels at zero
+    std::memset(source.channels + length, 0, DmxMaxLength - length);
+    universe.latestSource = slot;
+    packetCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool InputEngine::combineSources(UniverseInput& universe, MergeMode mode){
+    Clock::time_point now = Clock::now();
+    bool b_first = true;
+    for(int i = 0; i < MaxSources; i++){
+        Source& source = universe.sources[i];
+        if(!source.b_active) continue;
+        if(now - source.lastReceived > SourceTimeout){
+            source.b_active = false;
+            continue;
+        }
+        //sources are always combined htp, except in ltp mode where the latest packet wins
+        if(mode == MergeMode::LTP && i != universe.latestSource) continue;
+        if(b_first) std::memcpy(universe.input, source.channels, DmxMaxLength);
+        else mergeHtp(universe.input, source.channels, DmxMaxLength);
+        b_first = false;
+    }
+    //in ltp mode the latest source may just have timed out while the other one is still alive
+    if(b_first && mode == MergeMode::LTP){
+        for(int i = 0; i < MaxSources && b_first; i++){
+            if(!universe.sources[i].b_active) continue;
+            std::memcpy(universe.input, universe.sources[i].channels, DmxMaxLength);
+            b_first = false;
+        }
+    }
+    return !b_first;
+}
+
+void InputEngine::restorePixels(uint16_t universeId, uint8_t* channels){
+    auto it = universes.find(universeId);
+    if(it == universes.end()) return;
+    UniverseInput& universe = *it->second;
+    if(!universe.b_merged) return;
+    std::memcpy(channels, universe.pixels, DmxMaxLength);
+    universe.b_merged = false;
+}
+
+bool InputEngine::merge(uint16_t universeId, uint8_t* channels, MergeMode mode){
+    UniverseInput* universe;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = universes.find(universeId);
+        if(it == universes.end()) return false;
+        universe = it->second.get();
+        if(!combineSources(*universe, mode)){
+            //nothing live, the pixels own every channel again once a source comes back
+            std::memset(universe->inputOwns, 0, DmxMaxLength);
+            return false;
+        }
+    }
+
+    std::memcpy(universe->pixels, channels, DmxMaxLength);
+    universe->b_merged = true;
+    switch(mode){
+        case MergeMode::HTP:
+            mergeHtp(channels, universe->input, DmxMaxLength);
+            break;
+        case MergeMode::LTP:
+            mergeLtp(channels, universe->input, universe->lastPixels, universe->lastInput, universe->inputOwns, DmxMaxLength);
+            break;
+        case MergeMode::Priority:
+            std::memcpy(channels, universe->input, DmxMaxLength);
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <asio/io_context.hpp>
+#include <asio/ip/udp.hpp>
+
+#include "PixelMapper.h"
+#include "ArtnetPacket.h"
+
+namespace PixelMapper::Artnet{
+
+//Receives ArtDmx packets on a dedicated network thread and merges them into the universes of one patch
+//the network thread only copies packets into preallocated per universe source buffers,
+//the ecs thread combines the sources and merges them with the pixel channels once per frame
+class InputEngine{
+public:
+
+    //art-net merges at most two sources per universe, a source that stays silent for 10s is dropped
+    static constexpr int MaxSources = 2;
+    static constexpr std::chrono::seconds SourceTimeout{10};
+
+    explicit InputEngine(uint16_t port = UdpPort);
+    ~InputEngine();
+
+    //ecs thread: only call this when the universes of the patch change, this is where allocations happen
+    void setUniverses(const std::vector<uint16_t>& universeIds);
+
+    //ecs thread: put back the pixel channels that the last merge overwrote, before the output plan writes the new frame
+    //channels the plan doesn't write would otherwise keep merged values and feed them back into the next merge
+    void restorePixels(uint16_t universeId, uint8_t* channels);
+
+    //ecs thread: merge the received sources into channels, returns false when nothing was received for this universe
+    bool merge(uint16_t universeId, uint8_t* channels, MergeMode mode);
+
+    //packets from this source port are dropped, so we don't receive our own output when sending to a local address
+    void ignoreSourcePort(uint16_t port){ ignoredPort = port; }
+
+    bool isOpen() const { return socket.is_open(); }
+    uint64_t getPacketCount() const { return packetCount.load(std::memory_order_relaxed); }
+
+private:
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Source{
+        uint32_t ipAddress = 0;
+        Clock::time_point lastReceived;
+        bool b_active = false;
+        uint8_t channels[DmxMaxLength] = {};
+    };
+
+    struct UniverseInput{
+        //network thread, guarded by the mutex
+        Source sources[MaxSources];
+        int latestSource = 0;
+        //ecs thread
+        bool b_merged = false;
+        uint8_t input[DmxMaxLength] = {};       //sources combined
+        uint8_t pixels[DmxMaxLength] = {};      //pixel channels before the last merge
+        uint8_t lastInput[DmxMaxLength] = {};   //ltp state, see mergeLtp()
+        uint8_t lastPixels[DmxMaxLength] = {};
+        uint8_t inputOwns[DmxMaxLength] = {};
+    };
+
+    void receive();
+    void handlePacket(size_t size);
+    bool combineSources(UniverseInput& universe, MergeMode mode);
+
+    std::mutex mutex;
+    std::unordered_map<uint16_t, std::unique_ptr<UniverseInput>> universes;
+
+    //owned by the network thread
+    asio::io_context ioContext;
+    asio::ip::udp::socket socket;
+    asio::ip::udp::endpoint sender;
+    uint8_t packet[sizeof(DmxPacket)];
+
+    std::atomic<uint16_t> ignoredPort{0};
+    std::atomic<uint64_t> packetCount{0};
+    std::thread thread;
+};
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,277 @@
+#include "ArtnetOutput.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace PixelMapper::Artnet{
+
+OutputEngine::OutputEngine() : socket(ioContext) {
+    asio::error_code error;
+    socket.open(asio::ip::udp::v4(), error);
+    if(error){
+        std::cout << "Could not open Art-Net output socket: " << error.message() << std::endl;
+        return;
+    }
+    //bind explicitly so the source port is known, the input engine uses it to drop our own packets
+    socket.bind(asio::ip::udp::endpoint(asio::ip::address_v4::any(), 0), error);
+    if(!error) localPort = socket.local_endpoint(error).port();
+    //nodes are often addressed with directed broadcasts (2.255.255.255 / 10.255.255.255)
+    socket.set_option(asio::socket_base::broadcast(true), error);
+    //a frame is sent as one burst of packets, give the kernel enough room to queue all of them
+    socket.set_option(asio::socket_base::send_buffer_size(4 * 1024 * 1024), error);
+
+    b_running = true;
+    thread = std::thread([this](){ outputLoop(); });
+}
+
+OutputEngine::~OutputEngine(){
+    b_running = false;
+    if(thread.joinable()) thread.join();
+    asio::error_code error;
+    socket.close(error);
+}
+
+void OutputEngine::setRoutes(const std::vector<Route>& newRoutes, const std::vector<uint32_t>& syncAddresses){
+    auto table = std::make_shared<RouteTable>();
+    table->routes = newRoutes;
+    table->syncAddresses = syncAddresses;
+    routeTable = table;
+}
+
+void OutputEngine::publish(int64_t publishTime){
+    Frame& frame = frames.getWriteBuffer();
+    if(frame.routes != routeTable) frame.routes = routeTable;
+    if(publishTime == 0) publishTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    frame.publishTime = publishTime;
+    if(!routeTable) {
+        frames.publish();
+        return;
+    }
+    const auto& routes = routeTable->routes;
+    //only grows when universes are added, steady state frames don't allocate
+    frame.channels.resize(routes.size() * DmxMaxLength);
+    uint8_t* out = frame.channels.data();
+    for(const auto& route : routes){
+        std::memcpy(out, route.channels, DmxMaxLength);
+        out += DmxMaxLength;
+    }
+    frames.publish();
+}
+
+void OutputEngine::outputLoop(){
+    scheduler.reset();
+    while(b_running.load(std::memory_order_relaxed)){
+        scheduler.waitForNextFrame();
+
+        //when no new frame was published we resend the last one, nodes expect a steady stream
+        frames.update();
+        if(b_enabled.load(std::memory_order_relaxed)) send(frames.getReadBuffer());
+    }
+}
+
+void OutputEngine::rebuildPackets(const RouteTable& table){
+    endpoints.resize(table.routes.size());
+    headers.resize(table.routes.size());
+    for(size_t i = 0; i < table.routes.size(); i++){
+        const Route& route = table.routes[i];
+        endpoints[i] = asio::ip::udp::endpoint(asio::ip::address_v4(route.ipAddress), UdpPort);
+        writeDmxHeader(headers[i], route.universeId, route.length);
+    }
+    //a new routing sends every universe once, whatever was sent before
+    lastSent.assign(table.routes.size() * DmxMaxLength, 0);
+    //(longer ago than any keep alive interval)
+    lastSentTime.assign(table.routes.size(), std::chrono::steady_clock::now() - std::chrono::hours(1));
+    syncEndpoints.resize(table.syncAddresses.size());
+    for(size_t i = 0; i < table.syncAddresses.size(); i++){
+        syncEndpoints[i] = asio::ip::udp::endpoint(asio::ip::address_v4(table.syncAddresses[i]), UdpPort);
+    }
+    writeSyncPacket(syncPacket);
+
+#if defined(__linux__)
+    //everything but the channel pointers stays the same until the routing changes again
+    size_t packetCount = headers.size();
+    messages.assign(packetCount + syncEndpoints.size(), mmsghdr{});
+    iovecs.assign(packetCount * 2 + syncEndpoints.size(), iovec{});
+    for(size_t i = 0; i < packetCount; i++){
+        iovecs[i * 2] = iovec{headers[i].data, DmxHeaderSize};
+        iovecs[i * 2 + 1] = iovec{nullptr, table.routes[i].length};
+        msghdr& message = messages[i].msg_hdr;
+        message.msg_name = endpoints[i].data();
+        message.msg_namelen = socklen_t(endpoints[i].size());
+        message.msg_iov = &iovecs[i * 2];
+        message.msg_iovlen = 2;
+    }
+    for(size_t i = 0; i < syncEndpoints.size(); i++){
+        iovec& syncVector = iovecs[packetCount * 2 + i];
+        syncVector = iovec{syncPacket.data, SyncPacketSize};
+        msghdr& message = messages[packetCount + i].msg_hdr;
+        message.msg_name = syncEndpoints[i].data();
+        message.msg_namelen = socklen_t(syncEndpoints[i].size());
+        message.msg_iov = &syncVector;
+        message.msg_iovlen = 1;
+    }
+    batch.reserve(messages.size());
+    batchRoutes.reserve(packetCount);
+#endif
+}
+
+//unchanged universes are only refreshed at the keep alive interval, nodes expect to hear from every universe now and then
+bool OutputEngine::selectPacket(size_t index, const uint8_t* channels, std::chrono::steady_clock::time_point now, std::chrono::nanoseconds keepAlive) const{
+    size_t length = packetRoutes->routes[index].length;
+    const uint8_t* sent = lastSent.data() + index * DmxMaxLength;
+    if(keepAlive.count() > 0 && now - lastSentTime[index] >= keepAlive) return true;
+    //memcmp is vectorized by the c library and bails out on the first difference
+    return keepAlive.count() == 0 || std::memcmp(channels, sent, length) != 0;
+}
+
+//only packets that actually left count as delivered, a failed send is retried with the next frame
+void OutputEngine::commitPacket(size_t index, const uint8_t* channels, std::chrono::steady_clock::time_point now){
+    std::memcpy(lastSent.data() + index * DmxMaxLength, channels, packetRoutes->routes[index].length);
+    lastSentTime[index] = now;
+}
+
+void OutputEngine::send(const Frame& frame){
+    if(!socket.is_open() || !frame.routes) return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if(frame.routes != packetRoutes){
+        packetRoutes = frame.routes;
+        rebuildPackets(*packetRoutes);
+    }
+
+    //sequence 0 means sequencing is disabled, so we cycle 1..255
+    sequence = sequence == 255 ? 1 : sequence + 1;
+    for(DmxHeader& header : headers) setDmxSequence(header, sequence);
+
+    //the dmx burst goes out back to back, the syncs at the end release it at all nodes at the same time
+    const uint8_t* channels = frame.channels.data();
+    auto keepAlive = std::chrono::nanoseconds(keepAliveNanoseconds.load(std::memory_order_relaxed));
+    size_t packetCount = 0;
+    size_t droppedCount = 0;
+#if defined(__linux__)
+    batch.clear();
+    batchRoutes.clear();
+    for(size_t i = 0; i < headers.size(); i++){
+        const uint8_t* data = channels + i * DmxMaxLength;
+        if(!selectPacket(i, data, start, keepAlive)) continue;
+        //the frame buffer rotates through the triple buffer, so the payload pointers are set every frame
+        iovecs[i * 2 + 1].iov_base = const_cast<uint8_t*>(data);
+        batch.push_back(messages[i]);
+        batchRoutes.push_back(uint32_t(i));
+    }
+    size_t selectedCount = batch.size();
+    batch.insert(batch.end(), messages.begin() + headers.size(), messages.end());
+    //sendmmsg takes at most UIO_MAXIOV (1024) messages per call
+    constexpr size_t MaxBatch = 1024;
+    int handle = socket.native_handle();
+    size_t sent = 0;
+    while(sent < batch.size()){
+        unsigned int count = unsigned(std::min(batch.size() - sent, MaxBatch));
+        int result = ::sendmmsg(handle, batch.data() + sent, count, 0);
+        if(result > 0){
+            //dmx messages come first, the ones past selectedCount are the syncs
+            for(size_t message = sent; message < sent + size_t(result); message++){
+                if(message < selectedCount){
+                    size_t route = batchRoutes[message];
+                    commitPacket(route, channels + route * DmxMaxLength, start);
+                }
+                packetCount++;
+            }
+            sent += size_t(result);
+        }
+        else if(result < 0 && errno == EINTR) continue;
+        else{
+            //the first message of the batch failed (unreachable route...), drop it and carry on with the next one
+            droppedCount++;
+            sent++;
+        }
+    }
+    size_t skippedCount = headers.size() - selectedCount;
+#else
+    size_t selectedCount = 0;
+    for(size_t i = 0; i < headers.size(); i++){
+        const uint8_t* data = channels + i * DmxMaxLength;
+        if(!selectPacket(i, data, start, keepAlive)) continue;
+        selectedCount++;
+        std::array<asio::const_buffer, 2> buffers{
+            asio::buffer(headers[i].data, DmxHeaderSize),
+            asio::buffer(data, packetRoutes->routes[i].length)
+        };
+        asio::error_code error;
+        socket.send_to(buffers, endpoints[i], 0, error);
+        if(error){
+            droppedCount++;
+            continue;
+        }
+        commitPacket(i, data, start);
+        packetCount++;
+    }
+    size_t skippedCount = headers.size() - selectedCount;
+    for(const auto& endpoint : syncEndpoints){
+        asio::error_code error;
+        socket.send_to(asio::buffer(&syncPacket, sizeof(SyncPacket)), endpoint, 0, error);
+        if(error) droppedCount++;
+        else packetCount++;
+    }
+#endif
+
+    //resent frames and frames rendered from the same video frame only count once, when their content first left
+    auto end = std::chrono::steady_clock::now();
+    double latency = -1.0;
+    if(frame.publishTime != lastPublishTime){
+        lastPublishTime = frame.publishTime;
+        latency = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end.time_since_epoch()).count() - frame.publishTime) / 1e6;
+    }
+    recordSend(end - start, packetCount, skippedCount, droppedCount, latency);
+}
+
+//latency is negative when the frame was already measured
+void OutputEngine::recordSend(std::chrono::steady_clock::duration duration, size_t packetCount, size_t skippedCount, size_t droppedCount, double latency){
+    auto now = std::chrono::steady_clock::now();
+    if(statisticsStart == std::chrono::steady_clock::time_point()) statisticsStart = now;
+    double milliseconds = std::chrono::duration<double, std::milli>(duration).count();
+    sendTimeSum += milliseconds;
+    sendTimeMax = std::max(sendTimeMax, milliseconds);
+    sendCount++;
+    intervalPackets += packetCount;
+    intervalSkipped += skippedCount;
+    intervalDropped += droppedCount;
+    totalPackets += packetCount;
+    totalDropped += droppedCount;
+    if(latency >= 0.0){
+        latencySum += latency;
+        latencyMax = std::max(latencyMax, latency);
+        latencyCount++;
+    }
+
+    double seconds = std::chrono::duration<double>(now - statisticsStart).count();
+    if(seconds < 1.0) return;
+    {
+        std::lock_guard<std::mutex> lock(statisticsMutex);
+        sendStatistics.averageSendTime = sendTimeSum / double(sendCount);
+        sendStatistics.maxSendTime = sendTimeMax;
+        sendStatistics.packetRate = double(intervalPackets) / seconds;
+        sendStatistics.skippedRate = double(intervalSkipped) / seconds;
+        sendStatistics.droppedRate = double(intervalDropped) / seconds;
+        sendStatistics.packetCount = totalPackets;
+        sendStatistics.droppedCount = totalDropped;
+        sendStatistics.averageLatency = latencyCount > 0 ? latencySum / double(latencyCount) : 0.0;
+        sendStatistics.maxLatency = latencyMax;
+    }
+    statisticsStart = now;
+    sendTimeSum = 0.0;
+    sendTimeMax = 0.0;
+    sendCount = 0;
+    intervalPackets = 0;
+    intervalSkipped = 0;
+    intervalDropped = 0;
+    latencySum = 0.0;
+    latencyMax = 0.0;
+    latencyCount = 0;
+}
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+    #include <sys/socket.h>
+    #include <sys/uio.h>
+#endif
+
+#include <asio/io_context.hpp>
+#include <asio/ip/udp.hpp>
+
+#include "ArtnetPacket.h"
+#include "utils/TripleBuffer.h"
+#include "utils/FrameScheduler.h"
+
+namespace PixelMapper::Artnet{
+
+//Sends the universes of one patch as ArtDmx packets on a dedicated output thread
+//the ecs thread publishes frames through a triple buffer, the output thread transmits the latest one
+//at the patch refresh rate, so a stalled gui frame only repeats the previous frame instead of delaying the output
+//packet headers are built once per routing change, a frame is sent straight from the published channel buffer
+//(scatter gather: header + channels) and on linux the whole frame goes out in as few sendmmsg calls as possible.
+//universes whose channels didn't change since they were last sent are skipped until the keep alive interval runs out
+class OutputEngine{
+public:
+
+    //cost of transmitting frames, refreshed about once per second
+    struct SendStatistics{
+        double averageSendTime = 0.0;   //milliseconds the output thread spends sending one frame
+        double maxSendTime = 0.0;
+        double packetRate = 0.0;        //packets per second (dmx and sync) that the socket accepted
+        double skippedRate = 0.0;       //unchanged universes per second that were not sent
+        double droppedRate = 0.0;       //packets per second the socket refused (unreachable node...), dmx is retried next frame
+        uint64_t packetCount = 0;       //since the engine started
+        uint64_t droppedCount = 0;
+        double averageLatency = 0.0;    //milliseconds from publishing a frame to its packets being sent, each frame counted once
+        double maxLatency = 0.0;
+    };
+
+    struct Route{
+        uint32_t ipAddress;
+        uint16_t universeId;
+        uint16_t length;         //channels sent, even and 2..512, see getDmxLength()
+        const uint8_t* channels; //points into the sparse (pointer stable) Artnet::Universe::Channels storage
+    };
+
+    OutputEngine();
+    ~OutputEngine();
+
+    //ecs thread: only call this when the universe routing changes, this is where allocations happen
+    //every frame is followed by an ArtSync to each of the sync addresses
+    void setRoutes(const std::vector<Route>& newRoutes, const std::vector<uint32_t>& syncAddresses);
+
+    //ecs thread: copy the current universe channels into a frame and hand it to the output thread
+    //publishTime is when the content was published by its producer (steady clock nanoseconds), 0 for now
+    void publish(int64_t publishTime = 0);
+
+    size_t getRouteCount() const { return routeTable ? routeTable->routes.size() : 0; }
+    //source port of the sent packets, 0 if the socket couldn't be bound
+    uint16_t getLocalPort() const { return localPort; }
+
+    //any thread
+    void setRefreshRate(double rate){ scheduler.setRate(rate); }
+    //a disabled engine keeps its thread but stops sending
+    void setEnabled(bool enabled){ b_enabled.store(enabled, std::memory_order_relaxed); }
+    //seconds, 0 disables change detection and sends every universe every frame
+    void setKeepAliveInterval(double seconds){
+        keepAliveNanoseconds.store(int64_t(std::max(seconds, 0.0) * 1e9), std::memory_order_relaxed);
+    }
+    FrameScheduler::Statistics getTimingStatistics() const { return scheduler.getStatistics(); }
+    SendStatistics getSendStatistics() const {
+        std::lock_guard<std::mutex> lock(statisticsMutex);
+        return sendStatistics;
+    }
+
+private:
+
+    struct RouteTable{
+        std::vector<Route> routes;
+        std::vector<uint32_t> syncAddresses;
+    };
+
+    struct Frame{
+        std::shared_ptr<const RouteTable> routes;
+        std::vector<uint8_t> channels; //512 bytes per route
+        int64_t publishTime = 0;
+    };
+
+    void outputLoop();
+    void rebuildPackets(const RouteTable& table);
+    void send(const Frame& frame);
+    bool selectPacket(size_t index, const uint8_t* channels, std::chrono::steady_clock::time_point now, std::chrono::nanoseconds keepAlive) const;
+    void commitPacket(size_t index, const uint8_t* channels, std::chrono::steady_clock::time_point now);
+    void recordSend(std::chrono::steady_clock::duration duration, size_t packetCount, size_t skippedCount, size_t droppedCount, double latency);
+
+    //owned by the ecs thread
+    std::shared_ptr<const RouteTable> routeTable;
+
+    TripleBuffer<Frame> frames;
+
+    //owned by the output thread
+    FrameScheduler scheduler;
+    asio::io_context ioContext;
+    asio::ip::udp::socket socket;
+    std::shared_ptr<const RouteTable> packetRoutes;
+    std::vector<asio::ip::udp::endpoint> endpoints;
+    std::vector<DmxHeader> headers;
+    std::vector<asio::ip::udp::endpoint> syncEndpoints;
+    SyncPacket syncPacket;
+    uint8_t sequence = 0;
+    int64_t lastPublishTime = 0;                                    //of the last frame whose latency was measured
+    std::vector<uint8_t> lastSent;                                  //512 bytes per route
+    std::vector<std::chrono::steady_clock::time_point> lastSentTime;
+    std::atomic<int64_t> keepAliveNanoseconds{1000000000};
+#if defined(__linux__)
+    //one message per packet, dmx packets first then the syncs
+    std::vector<mmsghdr> messages;
+    std::vector<iovec> iovecs;
+    std::vector<mmsghdr> batch;                                     //messages of the packets sent this frame
+    std::vector<uint32_t> batchRoutes;                              //route of each dmx message in the batch
+#endif
+
+    //send timing, accumulated on the output thread and published once per second
+    std::chrono::steady_clock::time_point statisticsStart;
+    double sendTimeSum = 0.0;
+    double sendTimeMax = 0.0;
+    uint64_t sendCount = 0;
+    uint64_t intervalPackets = 0;
+    uint64_t intervalSkipped = 0;
+    uint64_t intervalDropped = 0;
+    uint64_t totalPackets = 0;
+    uint64_t totalDropped = 0;
+    double latencySum = 0.0;
+    double latencyMax = 0.0;
+    uint64_t latencyCount = 0;
+    mutable std::mutex statisticsMutex;
+    SendStatistics sendStatistics;
+
+    uint16_t localPort = 0;
+
+    std::atomic<bool> b_running{false};
+    std::atomic<bool> b_enabled{true};
+    std::thread thread;
+};
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace PixelMapper::Artnet{
+
+    constexpr uint16_t UdpPort = 6454;
+    constexpr uint16_t ProtocolVersion = 14;
+    constexpr uint16_t OpDmx = 0x5000;
+    constexpr uint16_t OpSync = 0x5200;
+
+    constexpr size_t DmxHeaderSize = 18;
+    constexpr size_t DmxMaxLength = 512;
+
+    //ArtDmx header, the channel data follows it directly on the wire
+    struct DmxHeader{
+        uint8_t data[DmxHeaderSize];
+    };
+    //ArtDmx packet, laid out exactly as it goes on the wire
+    struct DmxPacket{
+        DmxHeader header;
+        uint8_t data[DmxMaxLength];
+    };
+    static_assert(sizeof(DmxPacket) == DmxHeaderSize + DmxMaxLength);
+
+    inline void writeHeaderId(uint8_t* header, uint16_t opCode){
+        const char id[8] = {'A','r','t','-','N','e','t', 0};
+        for(int i = 0; i < 8; i++) header[i] = id[i];
+        header[8] = opCode & 0xFF;          //OpCode is little endian
+        header[9] = opCode >> 8;
+        header[10] = ProtocolVersion >> 8;  //ProtVer is big endian
+        header[11] = ProtocolVersion & 0xFF;
+    }
+
+    //universe is the 15 bit Port-Address (Net:SubNet:Universe)
+    inline void writeDmxHeader(DmxHeader& header, uint16_t universe, uint16_t length = DmxMaxLength){
+        uint8_t* h = header.data;
+        writeHeaderId(h, OpDmx);
+        h[12] = 0;                          //sequence, set per frame
+        h[13] = 0;                          //physical port
+        h[14] = universe & 0xFF;            //SubUni
+        h[15] = (universe >> 8) & 0x7F;     //Net
+        h[16] = length >> 8;                //length is big endian
+        h[17] = length & 0xFF;
+    }
+
+    inline void setDmxSequence(DmxHeader& header, uint8_t sequence){ header.data[12] = sequence; }
+
+    //ArtDmx data length has to be even and between 2 and 512
+    constexpr uint16_t getDmxLength(size_t usedSize){
+        size_t length = (usedSize + 1) & ~size_t(1);
+        return uint16_t(length < 2 ? 2 : (length > DmxMaxLength ? DmxMaxLength : length));
+    }
+
+    //ArtSync, nodes that received one hold back their ArtDmx data and output all universes on the next sync
+    //a node that doesn't see a sync for 4 seconds falls back to outputting every ArtDmx packet immediately
+    constexpr size_t SyncPacketSize = 14;
+
+    struct SyncPacket{
+        uint8_t data[SyncPacketSize];
+    };
+
+    inline void writeSyncPacket(SyncPacket& packet){
+        writeHeaderId(packet.data, OpSync);
+        packet.data[12] = 0;                //Aux1
+        packet.data[13] = 0;                //Aux2
+    }
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,72 @@
+#include "DmxMerge.h"
+
+#include <algorithm>
+
+#include "utils/Simd.h"
+
+namespace PixelMapper::Artnet{
+
+static void mergeHtpScalar(uint8_t* channels, const uint8_t* input, size_t begin, size_t end){
+    for(size_t i = begin; i < end; i++) channels[i] = std::max(channels[i], input[i]);
+}
+
+static void mergeLtpScalar(uint8_t* channels, const uint8_t* input, uint8_t* lastPixels, uint8_t* lastInput, uint8_t* inputOwns, size_t begin, size_t end){
+    for(size_t i = begin; i < end; i++){
+        if(input[i] != lastInput[i]) inputOwns[i] = 0xFF;
+        else if(channels[i] != lastPixels[i]) inputOwns[i] = 0x00;
+        lastPixels[i] = channels[i];
+        lastInput[i] = input[i];
+        if(inputOwns[i]) channels[i] = input[i];
+    }
+}
+
+void mergeHtp(uint8_t* channels, const uint8_t* input, size_t count){
+    size_t i = 0;
+#if defined(PIXELMAPPER_SSE2)
+    for(; i + 16 <= count; i += 16){
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(channels + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(channels + i), _mm_max_epu8(a, b));
+    }
+#elif defined(PIXELMAPPER_NEON)
+    for(; i + 16 <= count; i += 16){
+        vst1q_u8(channels + i, vmaxq_u8(vld1q_u8(channels + i), vld1q_u8(input + i)));
+    }
+#endif
+    mergeHtpScalar(channels, input, i, count);
+}
+
+void mergeLtp(uint8_t* channels, const uint8_t* input, uint8_t* lastPixels, uint8_t* lastInput, uint8_t* inputOwns, size_t count){
+    size_t i = 0;
+#if defined(PIXELMAPPER_SSE2)
+    for(; i + 16 <= count; i += 16){
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(channels + i));
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        __m128i pixelsSame = _mm_cmpeq_epi8(pixels, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lastPixels + i)));
+        __m128i inputSame = _mm_cmpeq_epi8(in, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lastInput + i)));
+        __m128i owns = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputOwns + i));
+        //owns = inputChanged | (owns & !pixelsChanged)
+        owns = _mm_or_si128(_mm_andnot_si128(inputSame, _mm_set1_epi8(-1)), _mm_and_si128(owns, pixelsSame));
+        __m128i merged = _mm_or_si128(_mm_and_si128(owns, in), _mm_andnot_si128(owns, pixels));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lastPixels + i), pixels);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lastInput + i), in);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(inputOwns + i), owns);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(channels + i), merged);
+    }
+#elif defined(PIXELMAPPER_NEON)
+    for(; i + 16 <= count; i += 16){
+        uint8x16_t pixels = vld1q_u8(channels + i);
+        uint8x16_t in = vld1q_u8(input + i);
+        uint8x16_t pixelsSame = vceqq_u8(pixels, vld1q_u8(lastPixels + i));
+        uint8x16_t inputSame = vceqq_u8(in, vld1q_u8(lastInput + i));
+        uint8x16_t owns = vorrq_u8(vmvnq_u8(inputSame), vandq_u8(vld1q_u8(inputOwns + i), pixelsSame));
+        vst1q_u8(lastPixels + i, pixels);
+        vst1q_u8(lastInput + i, in);
+        vst1q_u8(inputOwns + i, owns);
+        vst1q_u8(channels + i, vbslq_u8(owns, in, pixels));
+    }
+#endif
+    mergeLtpScalar(channels, input, lastPixels, lastInput, inputOwns, i, count);
+}
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace PixelMapper::Artnet{
+
+    //highest takes precedence: channels = max(channels, input)
+    void mergeHtp(uint8_t* channels, const uint8_t* input, size_t count);
+
+    //latest takes precedence, per channel: whichever of channels (the pixel output) and input changed last wins,
+    //input wins ties. lastPixels, lastInput and inputOwns (0x00 / 0xFF per channel) carry the state between frames
+    void mergeLtp(uint8_t* channels, const uint8_t* input, uint8_t* lastPixels, uint8_t* lastInput, uint8_t* inputOwns, size_t count);
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,78 @@
+#include "OutputPlan.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace PixelMapper::Artnet{
+
+    void compileFixtureSpans(
+        std::vector<CopySpan>& spans,
+        int pixelCount,
+        const PackFormat& format,
+        int startUniverse,
+        int startAddress,
+        const std::function<uint8_t*(uint16_t universeId)>& universeChannels)
+    {
+        const int channelsPerPixel = format.channelCount;
+        const int byteCount = pixelCount * channelsPerPixel;
+        int fixtureByte = 0;
+        int universeId = startUniverse;
+        int universeOffset = startAddress;
+
+        //walk the fixture bytes one universe slice at a time
+        while(fixtureByte < byteCount){
+            int sliceEnd = std::min(byteCount, fixtureByte + 512 - universeOffset);
+            uint8_t* channels = universeChannels(universeId);
+
+            if(channels){
+                int byte = fixtureByte;
+                uint8_t* destination = channels + universeOffset;
+
+                auto addSpan = [&](int firstPixel, int pixelSpan, int firstChannel, int spanBytes){
+                    spans.push_back(CopySpan{
+                        .source = uint32_t(firstPixel),
+                        .universeId = uint16_t(universeId),
+                        .destination = destination,
+                        .pixelCount = uint32_t(pixelSpan),
+                        .firstChannel = uint16_t(firstChannel),
+                        .byteCount = uint16_t(spanBytes),
+                        .format = &format
+                    });
+                    destination += spanBytes;
+                    byte += spanBytes;
+                };
+
+                //a pixel that straddles the previous universe boundary
+                if(byte % channelsPerPixel != 0){
+                    int firstChannel = byte % channelsPerPixel;
+                    addSpan(byte / channelsPerPixel, 1, firstChannel, std::min(channelsPerPixel - firstChannel, sliceEnd - byte));
+                }
+                //all whole pixels in this universe
+                int wholePixels = (sliceEnd - byte) / channelsPerPixel;
+                if(wholePixels > 0) addSpan(byte / channelsPerPixel, wholePixels, 0, wholePixels * channelsPerPixel);
+                //a pixel that continues into the next universe
+                if(byte < sliceEnd) addSpan(byte / channelsPerPixel, 1, 0, sliceEnd - byte);
+            }
+
+            fixtureByte = sliceEnd;
+            universeId++;
+            universeOffset = 0;
+        }
+    }
+
+    void executeOutputPlan(const OutputPlan& plan, const ColorRGBW* colors){
+        for(const CopySpan& span : plan.spans){
+            const PackFormat& format = *span.format;
+            if(span.firstChannel == 0 && span.byteCount == span.pixelCount * format.channelCount){
+                format.kernel(colors + span.source, span.destination, span.pixelCount, format);
+            }
+            else{
+                //partial pixel at a universe boundary
+                uint8_t pixel[8];
+                format.kernel(colors + span.source, pixel, 1, format);
+                std::memcpy(span.destination, pixel + span.firstChannel, span.byteCount);
+            }
+        }
+    }
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "PixelMapper.h"
+#include "PixelPacking.h"
+
+namespace PixelMapper::Artnet{
+
+    //append the copy spans of one fixture, universeChannels(universeId) must return the channel buffer of that universe
+    void compileFixtureSpans(
+        std::vector<CopySpan>& spans,
+        int pixelCount,
+        const PackFormat& format,
+        int startUniverse,
+        int startAddress,
+        const std::function<uint8_t*(uint16_t universeId)>& universeChannels);
+
+    void executeOutputPlan(const OutputPlan& plan, const ColorRGBW* colors);
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,303 @@
+#include "PixelPacking.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define PIXELMAPPER_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define TARGET_SSSE3
+        #define TARGET_AVX2
+    #else
+        #define TARGET_SSSE3 __attribute__((target("ssse3")))
+        #define TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+namespace PixelMapper::Artnet{
+
+    //————————————————————— SCALAR ————————————————————————
+
+    static void packScalar(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(source);
+        const int channels = format.channelCount;
+        for(size_t i = 0; i < pixelCount; i++){
+            for(int ch = 0; ch < channels; ch++) destination[ch] = in[format.order[ch]];
+            in += sizeof(ColorRGBW);
+            destination += channels;
+        }
+    }
+
+    static void packCopy(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        std::memcpy(destination, source, pixelCount * sizeof(ColorRGBW));
+    }
+
+#ifdef PIXELMAPPER_X86
+
+    //————————————————————— SSSE3 —————————————————————————
+    //each iteration shuffles 4 pixels (16 source bytes) in one register
+
+    TARGET_SSSE3 static void pack4Ssse3(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(format.shuffle));
+        size_t i = 0;
+        for(; i + 4 <= pixelCount; i += 4){
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_shuffle_epi8(v, mask));
+        }
+        packScalar(source + i, destination + i * 4, pixelCount - i, format);
+    }
+
+    TARGET_SSSE3 static void pack3Ssse3(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(format.shuffle));
+        size_t i = 0;
+        for(; i + 4 <= pixelCount; i += 4){
+            __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)), mask);
+            //12 valid bytes, stored as 8 + 4 so we never write past the span
+            uint8_t* out = destination + i * 3;
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), v);
+            int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+            std::memcpy(out + 8, &tail, 4);
+        }
+        packScalar(source + i, destination + i * 3, pixelCount - i, format);
+    }
+
+    TARGET_SSSE3 static void pack2Ssse3(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(format.shuffle));
+        size_t i = 0;
+        for(; i + 4 <= pixelCount; i += 4){
+            __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)), mask);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i * 2), v);
+        }
+        packScalar(source + i, destination + i * 2, pixelCount - i, format);
+    }
+
+    TARGET_SSSE3 static void pack1Ssse3(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(format.shuffle));
+        const __m128i* in = reinterpret_cast<const __m128i*>(source);
+        size_t i = 0;
+        //16 pixels per iteration, each shuffle leaves 4 bytes in the low dword
+        for(; i + 16 <= pixelCount; i += 16, in += 4){
+            __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(in + 0), mask);
+            __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), mask);
+            __m128i c = _mm_shuffle_epi8(_mm_loadu_si128(in + 2), mask);
+            __m128i d = _mm_shuffle_epi8(_mm_loadu_si128(in + 3), mask);
+            __m128i out = _mm_unpacklo_epi64(_mm_unpacklo_epi32(a, b), _mm_unpacklo_epi32(c, d));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), out);
+        }
+        packScalar(source + i, destination + i, pixelCount - i, format);
+    }
+
+    TARGET_SSSE3 static void packWideSsse3(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        const __m128i maskLow = _mm_load_si128(reinterpret_cast<const __m128i*>(format.shuffle));
+        const __m128i maskHigh = _mm_load_si128(reinterpret_cast<const __m128i*>(format.shuffleHigh));
+        const size_t groupBytes = format.channelCount * 4;
+        size_t i = 0;
+        for(; i + 4 <= pixelCount; i += 4){
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+            uint8_t* out = destination + i * format.channelCount;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(v, maskLow));
+            __m128i high = _mm_shuffle_epi8(v, maskHigh);
+            //the 16 bit orders (6 and 8 channels) store straight from the register
+            if(groupBytes == 32) _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), high);
+            else if(groupBytes == 24) _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), high);
+            else{
+                alignas(16) uint8_t bytes[16];
+                _mm_store_si128(reinterpret_cast<__m128i*>(bytes), high);
+                std::memcpy(out + 16, bytes, groupBytes - 16);
+            }
+        }
+        packScalar(source + i, destination + i * format.channelCount, pixelCount - i, format);
+    }
+
+    //————————————————————— AVX2 ——————————————————————————
+    //each iteration shuffles 8 pixels, the shuffle works inside each 128 bit lane
+
+    TARGET_AVX2 static void pack4Avx2(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        const __m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i*>(format.shuffle));
+        size_t i = 0;
+        for(; i + 8 <= pixelCount; i += 8){
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), _mm256_shuffle_epi8(v, mask));
+        }
+        packScalar(source + i, destination + i * 4, pixelCount - i, format);
+    }
+
+    TARGET_AVX2 static void pack3Avx2(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        const __m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i*>(format.shuffle));
+        //move the 3 valid dwords of the high lane down next to the 3 of the low lane
+        const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+        size_t i = 0;
+        for(; i + 8 <= pixelCount; i += 8){
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+            v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, mask), compact);
+            //24 valid bytes, stored as 16 + 8
+            uint8_t* out = destination + i * 3;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(v));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), _mm256_extracti128_si256(v, 1));
+        }
+        pack3Ssse3(source + i, destination + i * 3, pixelCount - i, format);
+    }
+
+    TARGET_AVX2 static void pack1Avx2(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        const __m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i*>(format.shuffle));
+        const __m256i interleave = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        const __m256i* in = reinterpret_cast<const __m256i*>(source);
+        size_t i = 0;
+        //32 pixels per iteration, each shuffle leaves 4 bytes in the low dword of each lane
+        for(; i + 32 <= pixelCount; i += 32, in += 4){
+            __m256i a = _mm256_shuffle_epi8(_mm256_loadu_si256(in + 0), mask);
+            __m256i b = _mm256_shuffle_epi8(_mm256_loadu_si256(in + 1), mask);
+            __m256i c = _mm256_shuffle_epi8(_mm256_loadu_si256(in + 2), mask);
+            __m256i d = _mm256_shuffle_epi8(_mm256_loadu_si256(in + 3), mask);
+            __m256i out = _mm256_unpacklo_epi64(_mm256_unpacklo_epi32(a, b), _mm256_unpacklo_epi32(c, d));
+            out = _mm256_permutevar8x32_epi32(out, interleave);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), out);
+        }
+        pack1Ssse3(source + i, destination + i, pixelCount - i, format);
+    }
+
+#endif//PIXELMAPPER_X86
+
+    //——————————————————— DISPATCH ————————————————————————
+
+    using InstructionSet = PackInstructionSet;
+
+    static InstructionSet detectInstructionSet(){
+#ifdef PIXELMAPPER_X86
+    #if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bool ssse3 = info[2] & (1 << 9);
+        bool osxsave = info[2] & (1 << 27);
+        bool avx2 = false;
+        if(maxLeaf >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6){
+            __cpuidex(info, 7, 0);
+            avx2 = info[1] & (1 << 5);
+        }
+    #else
+        __builtin_cpu_init();
+        bool ssse3 = __builtin_cpu_supports("ssse3");
+        bool avx2 = __builtin_cpu_supports("avx2");
+    #endif
+        if(avx2) return InstructionSet::Avx2;
+        if(ssse3) return InstructionSet::Ssse3;
+#endif
+        return InstructionSet::Scalar;
+    }
+
+    static InstructionSet getInstructionSet(){
+        static const InstructionSet instructionSet = detectInstructionSet();
+        return instructionSet;
+    }
+
+    const char* getPackingInstructionSet(){
+        switch(getInstructionSet()){
+            case InstructionSet::Avx2: return "AVX2";
+            case InstructionSet::Ssse3: return "SSSE3";
+            default: return "Scalar";
+        }
+    }
+
+    static PackKernel selectKernel(const PackFormat& format, InstructionSet instructionSet){
+        bool identity = true;
+        for(int ch = 0; ch < format.channelCount; ch++) if(format.order[ch] != ch) identity = false;
+        if(format.channelCount == 4 && identity) return packCopy;
+#ifdef PIXELMAPPER_X86
+        if(instructionSet == InstructionSet::Avx2){
+            switch(format.channelCount){
+                case 4: return pack4Avx2;
+                case 3: return pack3Avx2;
+                case 2: return pack2Ssse3;
+                case 1: return pack1Avx2;
+                default: return packWideSsse3;
+            }
+        }
+        else if(instructionSet == InstructionSet::Ssse3){
+            switch(format.channelCount){
+                case 4: return pack4Ssse3;
+                case 3: return pack3Ssse3;
+                case 2: return pack2Ssse3;
+                case 1: return pack1Ssse3;
+                default: return packWideSsse3;
+            }
+        }
+#endif
+        return packScalar;
+    }
+
+    PackKernel getPackKernel(const PackFormat& format, PackInstructionSet instructionSet){
+        if(instructionSet == InstructionSet::Scalar) return packScalar;
+        if(instructionSet > getInstructionSet()) return nullptr;
+        return selectKernel(format, instructionSet);
+    }
+
+    PackFormat makePackFormat(int channelCount, const uint8_t* order){
+        PackFormat format{};
+        format.channelCount = uint8_t(std::clamp(channelCount, 1, 8));
+        for(int ch = 0; ch < 8; ch++) format.order[ch] = ch < format.channelCount ? (order[ch] & 0x3) : 0;
+
+        //output byte k of a 4 pixel group comes from pixel k / channelCount, channel k % channelCount
+        //0x80 zeroes the unused tail of the register
+        for(int k = 0; k < 32; k++){
+            int pixel = k / format.channelCount;
+            int channel = k % format.channelCount;
+            uint8_t index = pixel < 4 ? uint8_t(pixel * 4 + format.order[channel]) : 0x80;
+            if(k < 16){
+                format.shuffle[k] = index;
+                format.shuffle[k + 16] = index;
+            }
+            else format.shuffleHigh[k - 16] = index;
+        }
+
+        format.kernel = selectKernel(format, getInstructionSet());
+        return format;
+    }
+
+    const PackFormat& getDefaultPackFormat(int channelsPerPixel){
+        static const uint8_t rgbw[4] = {0, 1, 2, 3};
+        static const PackFormat formats[4] = {
+            makePackFormat(1, rgbw),
+            makePackFormat(2, rgbw),
+            makePackFormat(3, rgbw),
+            makePackFormat(4, rgbw)
+        };
+        return formats[std::clamp(channelsPerPixel, 1, 4) - 1];
+    }
+
+    const PackFormat& getPackFormat(Fixture::ChannelOrder order){
+        using enum Fixture::ChannelOrder;
+        static const auto formats = [](){
+            struct Entry{ Fixture::ChannelOrder order; std::initializer_list<uint8_t> channels; };
+            const Entry entries[] = {
+                {R,      {0}},
+                {RG,     {0, 1}},
+                {RGB,    {0, 1, 2}},
+                {RBG,    {0, 2, 1}},
+                {GRB,    {1, 0, 2}},
+                {GBR,    {1, 2, 0}},
+                {BRG,    {2, 0, 1}},
+                {BGR,    {2, 1, 0}},
+                {RGBW,   {0, 1, 2, 3}},
+                {GRBW,   {1, 0, 2, 3}},
+                {WRGB,   {3, 0, 1, 2}},
+                {RGB16,  {0, 0, 1, 1, 2, 2}},
+                {GRB16,  {1, 1, 0, 0, 2, 2}},
+                {RGBW16, {0, 0, 1, 1, 2, 2, 3, 3}}
+            };
+            std::array<PackFormat, size_t(Fixture::ChannelOrder::Count)> table{};
+            for(const auto& entry : entries){
+                table[size_t(entry.order)] = makePackFormat(int(entry.channels.size()), std::data(entry.channels));
+            }
+            return table;
+        }();
+        if(order >= Fixture::ChannelOrder::Count) return getDefaultPackFormat(4);
+        return formats[size_t(order)];
+    }
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "PixelMapper.h"
+
+namespace PixelMapper::Artnet{
+
+    struct PackFormat;
+    using PackKernel = void(*)(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format);
+
+    //describes how the 4 bytes of a ColorRGBW are written to the dmx channels of one pixel
+    //formats are built once, the kernel is picked for the channel count and the instruction set of the running cpu
+    //16 bit channels are expressed by emitting the same source byte twice (v * 257, big endian)
+    struct PackFormat{
+        uint8_t channelCount;               //1..8
+        uint8_t order[8];                   //source byte of each output channel (0=r 1=g 2=b 3=w)
+        alignas(32) uint8_t shuffle[32];    //output bytes 0..15 of a 4 pixel group, repeated for both avx2 lanes
+        alignas(16) uint8_t shuffleHigh[16];//output bytes 16..31 of a 4 pixel group, for formats wider than 4 channels
+        PackKernel kernel;
+    };
+
+    PackFormat makePackFormat(int channelCount, const uint8_t* order);
+
+    //emits the first channelsPerPixel bytes of each color in rgbw order
+    const PackFormat& getDefaultPackFormat(int channelsPerPixel);
+
+    const PackFormat& getPackFormat(Fixture::ChannelOrder order);
+
+    inline void packPixels(const ColorRGBW* source, uint8_t* destination, size_t pixelCount, const PackFormat& format){
+        format.kernel(source, destination, pixelCount, format);
+    }
+
+    //name of the instruction set the pack kernels were selected for
+    const char* getPackingInstructionSet();
+
+    enum class PackInstructionSet{ Scalar, Ssse3, Avx2 };
+
+    //kernel the format would use on a cpu with the given instruction set, for checking the vector kernels against
+    //the scalar one (Scalar always returns the plain per channel loop), null if the running cpu doesn't support it
+    PackKernel getPackKernel(const PackFormat& format, PackInstructionSet instructionSet);
+
+}//namespace PixelMapper::Artnet
@@ -0,0 +1,82 @@
+#include "PatchFile.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "utils/MappedFile.h"
+
+namespace PixelMapper::PatchFile{
+
+using namespace Binary;
+
+namespace{
+
+    template<typename T>
+    void write(std::ofstream& file, const T* data, size_t count){
+        file.write(reinterpret_cast<const char*>(data), std::streamsize(sizeof(T) * count));
+    }
+
+    //records point straight into the mapping, the file is validated once up front
+    struct View{
+        const Header* header;
+        const FixtureRecord* fixtures;
+        const DeviceRecord* devices;
+        const char* names;
+
+        bool read(const MappedFile& file){
+            if(file.size() < sizeof(Header)) return false;
+            header = reinterpret_cast<const Header*>(file.data());
+            if(std::memcmp(header->magic, Magic, sizeof(Magic)) != 0) return false;
+            if(header->version != Version) return false;
+            uint64_t expectedSize = sizeof(Header)
+                + uint64_t(header->fixtureCount) * sizeof(FixtureRecord)
+                + uint64_t(header->deviceCount) * sizeof(DeviceRecord)
+                + header->namesSize;
+            if(file.size() != expectedSize) return false;
+            fixtures = reinterpret_cast<const FixtureRecord*>(file.data() + sizeof(Header));
+            devices = reinterpret_cast<const DeviceRecord*>(fixtures + header->fixtureCount);
+            names = reinterpret_cast<const char*>(devices + header->deviceCount);
+            //every name must be terminated inside the block
+            if(header->namesSize > 0 && names[header->namesSize - 1] != 0) return false;
+            return true;
+        }
+    };
+
+}//namespace
+
+
+bool saveBinary(flecs::entity patch, const char* path){
+    Records records;
+    if(!collect(patch, records)) return false;
+
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.fixtureCount = records.fixtures.size();
+    header.deviceCount = records.devices.size();
+    header.namesSize = records.names.size();
+    header.refreshRate = records.refreshRate;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file) return false;
+    write(file, &header, 1);
+    write(file, records.fixtures.data(), records.fixtures.size());
+    write(file, records.devices.data(), records.devices.size());
+    write(file, records.names.data(), records.names.size());
+    return file.good();
+}
+
+
+flecs::entity loadBinary(flecs::entity pixelMapper, const char* path){
+    MappedFile file(path);
+    if(!file.isOpen()) return flecs::entity::null();
+    View view;
+    if(!view.read(file)) return flecs::entity::null();
+
+    return build(pixelMapper, view.header->refreshRate,
+                 view.fixtures, view.header->fixtureCount,
+                 view.devices, view.header->deviceCount,
+                 view.names, view.header->namesSize);
+}
+
+}//namespace PixelMapper::PatchFile
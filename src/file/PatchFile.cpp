@@ -0,0 +1,173 @@
+#include "PatchFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+
+namespace PixelMapper::PatchFile{
+
+using namespace Binary;
+
+uint32_t Records::appendName(const char* name){
+    if(name == nullptr || name[0] == 0) return NoName;
+    uint32_t offset = names.size();
+    names.insert(names.end(), name, name + std::strlen(name) + 1);
+    return offset;
+}
+
+
+bool collect(flecs::entity patch, Records& records){
+    if(!patch.is_valid() || !patch.has<Patch::Is>()) return false;
+    flecs::world world = patch.world();
+
+    records.refreshRate = patch.get<Patch::Settings>().refreshRate;
+    records.fixtures.reserve(Fixture::getCountWithDmx(patch));
+
+    Fixture::iterateWithDmx(patch, [&](flecs::entity fixture, Fixture::Layout& layout, Fixture::DmxAddress& dmx){
+        FixtureRecord record{};
+        record.name = records.appendName(fixture.name().c_str());
+        record.pixelCount = layout.pixelCount;
+        record.channelsPerPixel = layout.channelsPerPixel;
+        if(auto* format = fixture.try_get<Fixture::ChannelFormat>()) record.channelFormat = uint8_t(format->order);
+        else record.channelFormat = NoChannelFormat;
+        record.universe = dmx.universe;
+        record.address = dmx.address;
+        flecs::entity shapeType = fixture.target<Fixture::WithShape>();
+        if(shapeType == world.id<Shape::Line>()){
+            const Shape::Line& line = fixture.get<Fixture::WithShape, Shape::Line>();
+            record.shapeType = ShapeType::Line;
+            record.shape[0] = line.start.x;
+            record.shape[1] = line.start.y;
+            record.shape[2] = line.end.x;
+            record.shape[3] = line.end.y;
+        }
+        else if(shapeType == world.id<Shape::Circle>()){
+            const Shape::Circle& circle = fixture.get<Fixture::WithShape, Shape::Circle>();
+            record.shapeType = ShapeType::Circle;
+            record.shape[0] = circle.center.x;
+            record.shape[1] = circle.center.y;
+            record.shape[2] = circle.radius;
+        }
+        records.fixtures.push_back(record);
+    });
+
+    Artnet::Device::iterate(patch, [&](flecs::entity device, Artnet::Device::IpAddress& ip, Artnet::Device::UniverseRange& range){
+        records.devices.push_back(DeviceRecord{
+            .name = records.appendName(device.name().c_str()),
+            .ipAddress = ip.address,
+            .firstUniverse = range.first,
+            .universeCount = range.count
+        });
+    });
+
+    return true;
+}
+
+
+namespace{
+    //names read from files become flecs entity names, which have to be unique among siblings (flecs aborts otherwise)
+    //and must not contain the path separators : and . that would create nested entities instead
+    class UniqueNames{
+    public:
+        //the sanitized name, or generatedPrefix + number when there is none, with " (n)" appended on a collision
+        const std::string& make(const char* name, const char* generatedPrefix, size_t number){
+            candidate.clear();
+            if(name) for(const char* c = name; *c; c++) candidate.push_back(*c == ':' || *c == '.' ? '_' : *c);
+            if(candidate.empty()) candidate = generatedPrefix + std::to_string(number);
+            if(used.count(candidate)){
+                std::string base = candidate;
+                for(int n = 2; used.count(candidate); n++) candidate = base + " (" + std::to_string(n) + ")";
+            }
+            used.insert(candidate);
+            return candidate;
+        }
+    private:
+        std::unordered_set<std::string> used;
+        std::string candidate;
+    };
+}//namespace
+
+flecs::entity build(flecs::entity pixelMapper, float refreshRate,
+                    const FixtureRecord* fixtures, size_t fixtureCount,
+                    const DeviceRecord* devices, size_t deviceCount,
+                    const char* names, size_t namesSize){
+
+    auto getName = [&](uint32_t offset) -> const char* {
+        if(offset == NoName || offset >= namesSize) return nullptr;
+        return names + offset;
+    };
+
+    flecs::entity patch = Patch::create(pixelMapper);
+    if(!patch.is_valid()) return flecs::entity::null();
+    flecs::entity deviceFolder = patch.target<Patch::DeviceFolder>();
+    flecs::world world = patch.world();
+
+    //all fixtures are created in one deferred block, each entity moves to its final table once when the block is merged
+    //and the observers + dirty systems compile the pixel store and dmx map for the whole patch in a single pass
+    world.defer_begin();
+
+    //fixtures and devices live in different folders, their names only have to be unique within each
+    UniqueNames fixtureNames;
+    for(size_t i = 0; i < fixtureCount; i++){
+        const FixtureRecord& record = fixtures[i];
+        flecs::entity fixture = Fixture::create(patch, std::max<uint32_t>(record.pixelCount, 1), record.channelsPerPixel);
+        fixture.set_name(fixtureNames.make(getName(record.name), "Fixture ", i + 1).c_str());
+        fixture.set<Fixture::DmxAddress>({record.universe, record.address});
+        if(record.channelFormat < uint8_t(Fixture::ChannelOrder::Count)){
+            fixture.set<Fixture::ChannelFormat>({Fixture::ChannelOrder(record.channelFormat)});
+        }
+        switch(record.shapeType){
+            case ShapeType::Line:
+                fixture.set<Fixture::WithShape, Shape::Line>({
+                    glm::vec2(record.shape[0], record.shape[1]),
+                    glm::vec2(record.shape[2], record.shape[3])
+                });
+                break;
+            case ShapeType::Circle:
+                fixture.set<Fixture::WithShape, Shape::Circle>({
+                    glm::vec2(record.shape[0], record.shape[1]),
+                    record.shape[2]
+                });
+                break;
+            default:
+                break;
+        }
+    }
+
+    UniqueNames deviceNames;
+    for(size_t i = 0; i < deviceCount; i++){
+        const DeviceRecord& record = devices[i];
+        flecs::entity device = world.entity().child_of(deviceFolder);
+        device.set_name(deviceNames.make(getName(record.name), "Device ", i + 1).c_str());
+        device.add<Artnet::Device::Is>()
+            .set<Artnet::Device::IpAddress>({record.ipAddress})
+            .set<Artnet::Device::UniverseRange>({record.firstUniverse, record.universeCount});
+    }
+
+    patch.set<Patch::Settings>({refreshRate});
+
+    world.defer_end();
+
+    return patch;
+}
+
+
+static bool isXmlPath(const char* path){
+    size_t length = std::strlen(path);
+    if(length < 4) return false;
+    const char* extension = path + length - 4;
+    return std::tolower(extension[0]) == '.' && std::tolower(extension[1]) == 'x'
+        && std::tolower(extension[2]) == 'm' && std::tolower(extension[3]) == 'l';
+}
+
+bool save(flecs::entity patch, const char* path){
+    return isXmlPath(path) ? saveXml(patch, path) : saveBinary(patch, path);
+}
+
+flecs::entity load(flecs::entity pixelMapper, const char* path){
+    return isXmlPath(path) ? loadXml(pixelMapper, path) : loadBinary(pixelMapper, path);
+}
+
+}//namespace PixelMapper::PatchFile
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "PixelMapper.h"
+
+namespace PixelMapper::PatchFile{
+
+    //Binary patch format, versioned, native little endian
+    //[Header][FixtureRecord * fixtureCount][DeviceRecord * deviceCount][names, null terminated]
+    //records are fixed size so a mapped file is read in place without any parsing
+    namespace Binary{
+        constexpr char Magic[4] = {'P', 'X', 'M', 'P'};
+        constexpr uint32_t Version = 1;
+        constexpr uint32_t NoName = UINT32_MAX;
+        constexpr uint8_t NoChannelFormat = UINT8_MAX;
+
+        enum class ShapeType : uint8_t{
+            None = 0,
+            Line = 1,
+            Circle = 2
+        };
+
+        struct Header{
+            char magic[4];
+            uint32_t version;
+            uint32_t fixtureCount;
+            uint32_t deviceCount;
+            uint32_t namesSize;
+            float refreshRate;
+            uint32_t reserved[2];
+        };
+        struct FixtureRecord{
+            uint32_t name;              //offset into the names block or NoName
+            uint32_t pixelCount;
+            uint8_t channelsPerPixel;
+            uint8_t channelFormat;      //Fixture::ChannelOrder or NoChannelFormat
+            ShapeType shapeType;
+            uint8_t reserved;
+            uint16_t universe;
+            uint16_t address;
+            float shape[4];             //line: start xy, end xy / circle: center xy, radius
+        };
+        struct DeviceRecord{
+            uint32_t name;
+            uint32_t ipAddress;
+            uint16_t firstUniverse;
+            uint16_t universeCount;
+        };
+
+        static_assert(sizeof(Header) == 32);
+        static_assert(sizeof(FixtureRecord) == 32);
+        static_assert(sizeof(DeviceRecord) == 12);
+    };
+
+    //patch content decoded to flat records, the common ground of all file formats
+    struct Records{
+        float refreshRate = 44.0f;
+        std::vector<Binary::FixtureRecord> fixtures;
+        std::vector<Binary::DeviceRecord> devices;
+        std::vector<char> names;
+        uint32_t appendName(const char* name);
+    };
+    bool collect(flecs::entity patch, Records& records);
+    //creates a new patch from records, all entities are created in a single deferred block
+    flecs::entity build(flecs::entity pixelMapper, float refreshRate,
+                        const Binary::FixtureRecord* fixtures, size_t fixtureCount,
+                        const Binary::DeviceRecord* devices, size_t deviceCount,
+                        const char* names, size_t namesSize);
+
+    //loaders create a new patch from the file, returning a null entity if the file can't be read or is invalid
+    bool saveBinary(flecs::entity patch, const char* path);
+    flecs::entity loadBinary(flecs::entity pixelMapper, const char* path);
+
+    bool saveXml(flecs::entity patch, const char* path);
+    flecs::entity loadXml(flecs::entity pixelMapper, const char* path);
+
+    //picks the format from the file extension, .xml or binary for anything else
+    bool save(flecs::entity patch, const char* path);
+    flecs::entity load(flecs::entity pixelMapper, const char* path);
+
+}//namespace PixelMapper::PatchFile
@@ -0,0 +1,219 @@
+#include "PatchFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <tinyxml2.h>
+
+//XML patch format, for interchange with other tools
+//<Patch version="1" refreshRate="44">
+//    <Fixtures>
+//        <Fixture name="" pixelCount="16" channelsPerPixel="3" channelFormat="GRB" universe="0" address="0">
+//            <Line startX="" startY="" endX="" endY=""/> or <Circle centerX="" centerY="" radius=""/>
+//        </Fixture>
+//    </Fixtures>
+//    <Devices>
+//        <Device name="" ip="10.0.0.1" firstUniverse="0" universeCount="16"/>
+//    </Devices>
+//</Patch>
+
+namespace PixelMapper::PatchFile{
+
+using namespace Binary;
+
+namespace{
+
+    constexpr uint32_t XmlVersion = 1;
+
+    uint8_t parseChannelFormat(const char* name){
+        if(name == nullptr) return NoChannelFormat;
+        for(uint8_t i = 0; i < uint8_t(Fixture::ChannelOrder::Count); i++){
+            if(std::strcmp(name, Fixture::getChannelOrderName(Fixture::ChannelOrder(i))) == 0) return i;
+        }
+        return NoChannelFormat;
+    }
+
+    std::string formatIpAddress(uint32_t ip){
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", (ip >> 24) & 0xFF, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF);
+        return buffer;
+    }
+
+    //tinyxml2 prints floats with 8 significant digits, 9 are needed to read back the same float
+    void pushFloat(tinyxml2::XMLPrinter& printer, const char* name, float value){
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        printer.PushAttribute(name, buffer);
+    }
+
+    uint32_t parseIpAddress(const char* text){
+        unsigned a, b, c, d;
+        if(text == nullptr || std::sscanf(text, "%u.%u.%u.%u", &a, &b, &c, &d) != 4) return 0;
+        if(a > 255 || b > 255 || c > 255 || d > 255) return 0;
+        return Artnet::Device::makeIpAddress(a, b, c, d);
+    }
+
+    //single pass over the document that decodes elements straight into flat records
+    //no element lookups or tree navigation, entities are only created afterwards in one batch
+    class PatchVisitor : public tinyxml2::XMLVisitor{
+    public:
+        Records records;
+        bool valid = false;
+        bool b_misplaced = false;  //a shape outside of a fixture, the file is rejected
+
+        bool VisitEnter(const tinyxml2::XMLElement& element, const tinyxml2::XMLAttribute*) override {
+            const char* name = element.Name();
+            if(std::strcmp(name, "Patch") == 0){
+                if(element.UnsignedAttribute("version", 0) != XmlVersion) return false; //skips the patch content, valid stays false
+                records.refreshRate = element.FloatAttribute("refreshRate", 44.0f);
+                valid = true;
+            }
+            else if(std::strcmp(name, "Fixture") == 0){
+                fixture = FixtureRecord{};
+                fixture.name = records.appendName(element.Attribute("name"));
+                fixture.pixelCount = element.UnsignedAttribute("pixelCount", 1);
+                fixture.channelsPerPixel = element.UnsignedAttribute("channelsPerPixel", 3);
+                fixture.channelFormat = parseChannelFormat(element.Attribute("channelFormat"));
+                fixture.universe = element.UnsignedAttribute("universe", 0);
+                fixture.address = element.UnsignedAttribute("address", 0);
+                fixture.shapeType = ShapeType::None;
+                b_inFixture = true;
+            }
+            else if((std::strcmp(name, "Line") == 0 || std::strcmp(name, "Circle") == 0) && !b_inFixture){
+                b_misplaced = true;
+                return false;
+            }
+            else if(std::strcmp(name, "Line") == 0){
+                fixture.shapeType = ShapeType::Line;
+                fixture.shape[0] = element.FloatAttribute("startX");
+                fixture.shape[1] = element.FloatAttribute("startY");
+                fixture.shape[2] = element.FloatAttribute("endX");
+                fixture.shape[3] = element.FloatAttribute("endY");
+            }
+            else if(std::strcmp(name, "Circle") == 0){
+                fixture.shapeType = ShapeType::Circle;
+                fixture.shape[0] = element.FloatAttribute("centerX");
+                fixture.shape[1] = element.FloatAttribute("centerY");
+                fixture.shape[2] = element.FloatAttribute("radius");
+            }
+            else if(std::strcmp(name, "Device") == 0){
+                records.devices.push_back(DeviceRecord{
+                    .name = records.appendName(element.Attribute("name")),
+                    .ipAddress = parseIpAddress(element.Attribute("ip")),
+                    .firstUniverse = uint16_t(element.UnsignedAttribute("firstUniverse", 0)),
+                    .universeCount = uint16_t(element.UnsignedAttribute("universeCount", 1))
+                });
+            }
+            return true;
+        }
+
+        bool VisitExit(const tinyxml2::XMLElement& element) override {
+            if(std::strcmp(element.Name(), "Fixture") == 0){
+                records.fixtures.push_back(fixture);
+                b_inFixture = false;
+            }
+            return true;
+        }
+
+    private:
+        FixtureRecord fixture{};
+        bool b_inFixture = false;
+    };
+
+}//namespace
+
+
+bool saveXml(flecs::entity patch, const char* path){
+    Records records;
+    if(!collect(patch, records)) return false;
+
+    auto getName = [&](uint32_t offset) -> const char* {
+        return offset == NoName ? "" : records.names.data() + offset;
+    };
+
+    FILE* file = std::fopen(path, "w");
+    if(file == nullptr) return false;
+
+    //the printer streams straight to the file, no document is built in memory
+    tinyxml2::XMLPrinter printer(file);
+    printer.PushHeader(false, true);
+    printer.OpenElement("Patch");
+    printer.PushAttribute("version", XmlVersion);
+    pushFloat(printer, "refreshRate", records.refreshRate);
+
+    printer.OpenElement("Fixtures");
+    for(const FixtureRecord& fixture : records.fixtures){
+        printer.OpenElement("Fixture");
+        printer.PushAttribute("name", getName(fixture.name));
+        printer.PushAttribute("pixelCount", fixture.pixelCount);
+        printer.PushAttribute("channelsPerPixel", unsigned(fixture.channelsPerPixel));
+        if(fixture.channelFormat != NoChannelFormat){
+            printer.PushAttribute("channelFormat", Fixture::getChannelOrderName(Fixture::ChannelOrder(fixture.channelFormat)));
+        }
+        printer.PushAttribute("universe", unsigned(fixture.universe));
+        printer.PushAttribute("address", unsigned(fixture.address));
+        switch(fixture.shapeType){
+            case ShapeType::Line:
+                printer.OpenElement("Line");
+                pushFloat(printer, "startX", fixture.shape[0]);
+                pushFloat(printer, "startY", fixture.shape[1]);
+                pushFloat(printer, "endX", fixture.shape[2]);
+                pushFloat(printer, "endY", fixture.shape[3]);
+                printer.CloseElement();
+                break;
+            case ShapeType::Circle:
+                printer.OpenElement("Circle");
+                pushFloat(printer, "centerX", fixture.shape[0]);
+                pushFloat(printer, "centerY", fixture.shape[1]);
+                pushFloat(printer, "radius", fixture.shape[2]);
+                printer.CloseElement();
+                break;
+            default:
+                break;
+        }
+        printer.CloseElement();
+    }
+    printer.CloseElement();
+
+    printer.OpenElement("Devices");
+    for(const DeviceRecord& device : records.devices){
+        printer.OpenElement("Device");
+        printer.PushAttribute("name", getName(device.name));
+        printer.PushAttribute("ip", formatIpAddress(device.ipAddress).c_str());
+        printer.PushAttribute("firstUniverse", unsigned(device.firstUniverse));
+        printer.PushAttribute("universeCount", unsigned(device.universeCount));
+        printer.CloseElement();
+    }
+    printer.CloseElement();
+
+    printer.CloseElement();
+    bool success = std::ferror(file) == 0;
+    std::fclose(file);
+    return success;
+}
+
+
+flecs::entity loadXml(flecs::entity pixelMapper, const char* path){
+    PatchVisitor visitor;
+    {
+        tinyxml2::XMLDocument document;
+        if(document.LoadFile(path) != tinyxml2::XML_SUCCESS) return flecs::entity::null();
+        document.Accept(&visitor);
+    }//the document is freed before any entity is created
+    if(!visitor.valid) return flecs::entity::null();
+    if(visitor.b_misplaced){
+        std::cout << "Patch file " << path << " has a Line or Circle outside of a Fixture" << std::endl;
+        return flecs::entity::null();
+    }
+
+    //hand edited names may repeat or contain path separators, build() makes them unique and flat
+    const Records& records = visitor.records;
+    return build(pixelMapper, records.refreshRate,
+                 records.fixtures.data(), records.fixtures.size(),
+                 records.devices.data(), records.devices.size(),
+                 records.names.data(), records.names.size());
+}
+
+}//namespace PixelMapper::PatchFile
@@ -2,6 +2,8 @@
 
 #include <imgui.h>
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <vector>
 
 class ImGuiCanvas{
 public:
@@ -33,11 +35,29 @@ public:
         frameMax = ImGui::GetItemRectMax();
         frameSize = ImGui::GetItemRectSize();
 
-        //if mouse is held down on canvas, allow dragging to move offset
+        //a press with shift held draws a selection rectangle, any other press drags the canvas
+        if(ImGui::IsItemActivated()){
+            b_selecting = ImGui::GetIO().KeyShift;
+            pressPosition = ImGui::GetMousePos();
+            selectionStart = screenToCanvas(pressPosition);
+            selectionEnd = selectionStart;
+        }
+        b_selectionFinished = false;
+        b_clicked = false;
         if(ImGui::IsItemActive()){
-            glm::vec2 drag = ImGui::GetMouseDragDelta();
-            offset -= drag;
-            ImGui::ResetMouseDragDelta();
+            if(b_selecting) selectionEnd = screenToCanvas(ImGui::GetMousePos());
+            else{
+                glm::vec2 drag = ImGui::GetMouseDragDelta();
+                offset -= drag;
+                ImGui::ResetMouseDragDelta();
+            }
+        }
+        else if(ImGui::IsItemDeactivated()){
+            //a press that barely moved is a click, not a drag
+            glm::vec2 moved = glm::vec2(ImGui::GetMousePos()) - pressPosition;
+            if(glm::dot(moved, moved) < 9.0f) b_clicked = true;
+            else if(b_selecting) b_selectionFinished = true;
+            b_selecting = false;
         }
 
         //if hovered, allow zoom by vertical scrolling
@@ -64,6 +84,41 @@ public:
         ImGui::PopClipRect();
     }
 
+    //true once when a click (press and release without dragging) ended on the canvas
+    bool isClicked(glm::vec2& canvasClickPos){
+        if(!b_clicked) return false;
+        canvasClickPos = screenToCanvas(pressPosition);
+        return true;
+    }
+
+    //true once when a shift drag selection ended, the rectangle is in canvas space
+    bool getSelection(glm::vec2& min, glm::vec2& max){
+        if(!b_selectionFinished) return false;
+        min = glm::min(selectionStart, selectionEnd);
+        max = glm::max(selectionStart, selectionEnd);
+        return true;
+    }
+
+    void drawSelection(uint32_t color){
+        if(!b_selecting) return;
+        drawing->AddRectFilled(canvasToScreen(selectionStart), canvasToScreen(selectionEnd), color & 0x33FFFFFF);
+        drawing->AddRect(canvasToScreen(selectionStart), canvasToScreen(selectionEnd), color);
+    }
+
+    //point in canvas space within margin screen pixels of the visible canvas
+    bool isVisible(glm::vec2 point, float margin){
+        glm::vec2 screen = canvasToScreen(point);
+        return screen.x >= frameMin.x - margin && screen.x <= frameMax.x + margin
+            && screen.y >= frameMin.y - margin && screen.y <= frameMax.y + margin;
+    }
+
+    //canvas space rectangle overlapping the visible canvas grown by margin screen pixels
+    bool isVisible(glm::vec2 min, glm::vec2 max, float margin){
+        float canvasMargin = screenSizeToCanvasSize(margin);
+        return max.x >= canvasMin.x - canvasMargin && min.x <= canvasMax.x + canvasMargin
+            && max.y >= canvasMin.y - canvasMargin && min.y <= canvasMax.y + canvasMargin;
+    }
+
     void drawGrid(float lineSpacing, uint32_t backgroundColor, uint32_t lineColor){
         float markerWidth = 1.0;
         drawing->AddRectFilled(frameMin, frameMax, backgroundColor);
@@ -83,6 +138,50 @@ public:
         }
     }
 
+    //batched preview of many points as colored squares, positions are in canvas space, getColor(i) returns an ImU32
+    //points outside the visible canvas are culled and only one point per screen cell of radius x radius is drawn,
+    //denser points can't be told apart at the current scaling anyway.
+    //quads are written straight into the draw list, reserved in chunks that stay below the 16 bit index limit
+    //indices, when given, selects count points out of x and y, getColor receives the point index
+    template<typename ColorFn>
+    void drawPoints(size_t count, const uint32_t* indices, const float* x, const float* y, float radius, ColorFn&& getColor){
+        glm::vec2 margin = glm::vec2(screenSizeToCanvasSize(radius));
+        glm::vec2 cullMin = canvasMin - margin;
+        glm::vec2 cullMax = canvasMax + margin;
+
+        float cellSize = std::max(radius, 1.0f);
+        int cellsX = int(frameSize.x / cellSize) + 3;
+        int cellsY = int(frameSize.y / cellSize) + 3;
+        occupiedCells.assign(size_t(cellsX) * size_t(cellsY), 0);
+        visiblePoints.clear();
+
+        for(size_t n = 0; n < count; n++){
+            size_t i = indices ? indices[n] : n;
+            if(x[i] < cullMin.x || x[i] > cullMax.x || y[i] < cullMin.y || y[i] > cullMax.y) continue;
+            glm::vec2 screen = canvasToScreen(glm::vec2(x[i], y[i]));
+            //one cell of border on each side for the points in the margin
+            int cellX = std::clamp(int((screen.x - frameMin.x) / cellSize) + 1, 0, cellsX - 1);
+            int cellY = std::clamp(int((screen.y - frameMin.y) / cellSize) + 1, 0, cellsY - 1);
+            uint8_t& cell = occupiedCells[size_t(cellY) * size_t(cellsX) + size_t(cellX)];
+            if(cell) continue;
+            cell = 1;
+            visiblePoints.push_back(Point{ImVec2(screen.x, screen.y), getColor(i)});
+        }
+
+        constexpr size_t QuadsPerChunk = 16000; //64000 vertices
+        for(size_t first = 0; first < visiblePoints.size(); first += QuadsPerChunk){
+            size_t quadCount = std::min(QuadsPerChunk, visiblePoints.size() - first);
+            drawing->PrimReserve(int(quadCount * 6), int(quadCount * 4));
+            for(size_t i = first; i < first + quadCount; i++){
+                const Point& point = visiblePoints[i];
+                drawing->PrimRect(
+                    ImVec2(point.position.x - radius, point.position.y - radius),
+                    ImVec2(point.position.x + radius, point.position.y + radius),
+                    point.color);
+            }
+        }
+    }
+
     bool isDoubleClicked(glm::vec2& canvasClickPos, ImGuiMouseButton button = ImGuiMouseButton_Left){
         if(ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(button)){
             canvasClickPos = screenToCanvas(ImGui::GetMousePos());
@@ -92,11 +191,15 @@ public:
     }
 
     bool dragHandle(const char* id, glm::vec2& point, float handleSize){
+        //handles off screen are skipped, except the one being dragged so it stays active when it leaves the frame
+        ImGuiID handleId = ImGui::GetID(id);
+        if(handleId != draggedHandle && !isVisible(point, handleSize)) return false;
         glm::vec2 windowPos = ImGui::GetWindowPos();
         glm::vec2 cursorPos = canvasToScreen(point) - windowPos - glm::vec2(handleSize*0.5);
         ImGui::SetCursorPos(cursorPos);
         ImGui::Button(id, glm::vec2(handleSize));
         if(ImGui::IsItemActive()){
+            draggedHandle = handleId;
             ImVec2 dragDelta = ImGui::GetMouseDragDelta();
             point += screenSizeToCanvasSize(dragDelta);
             if(dragDelta.x != 0.0 || dragDelta.y != 0.0) {
@@ -104,7 +207,26 @@ public:
                 return true;
             }
         }
+        else if(draggedHandle == handleId) draggedHandle = 0;
         return false;
     }
 
+private:
+
+    struct Point{
+        ImVec2 position;
+        ImU32 color;
+    };
+    //kept between frames so the preview doesn't allocate once it reached its size
+    std::vector<uint8_t> occupiedCells;
+    std::vector<Point> visiblePoints;
+
+    ImGuiID draggedHandle = 0;
+
+    bool b_selecting = false;
+    bool b_selectionFinished = false;
+    bool b_clicked = false;
+    glm::vec2 pressPosition;
+    glm::vec2 selectionStart, selectionEnd;
+
 };
\ No newline at end of file
@@ -1,13 +1,21 @@
 #include "PixelMapper.h"
+#include "artnet/ArtnetInput.h"
+#include "artnet/ArtnetOutput.h"
+#include "file/PatchFile.h"
+#include "render/EffectGraph.h"
+#include "render/SpatialIndex.h"
 
 #include "ImGuiCanvas.h"
 #include "ImGuiHexView.h"
 
+#include <algorithm>
 #include <iostream>
+#include <string>
 
 namespace PixelMapper::Gui{
 
 ImGuiCanvas canvas;
+std::vector<uint32_t> visiblePixels; //kept between frames, pixels on screen or in the selection rectangle
 
 void submit(flecs::entity application){
 
@@ -17,6 +25,26 @@ void submit(flecs::entity application){
 
     if(ImGui::BeginMainMenuBar()){
         if(ImGui::BeginMenu("PixelMapper")){
+            static char patchFilePath[512] = "patch.pxmp";
+            ImGui::InputText("Patch File", patchFilePath, sizeof(patchFilePath));
+            if(ImGui::MenuItem("Save Patch", nullptr, false, selectedPatch.is_valid())){
+                if(!PatchFile::save(selectedPatch, patchFilePath)) std::cout << "Could not save patch file " << patchFilePath << std::endl;
+            }
+            if(ImGui::MenuItem("Load Patch")){
+                //the gui system runs deferred, loading needs the patch folders to exist immediately
+                //so the load runs once the frame is merged
+                struct LoadRequest{
+                    flecs::entity application;
+                    std::string path;
+                };
+                application.world().run_post_frame([](ecs_world_t*, void* ctx){
+                    auto* request = static_cast<LoadRequest*>(ctx);
+                    flecs::entity loadedPatch = PatchFile::load(request->application, request->path.c_str());
+                    if(loadedPatch.is_valid()) Patch::select(request->application, loadedPatch);
+                    else std::cout << "Could not load patch file " << request->path << std::endl;
+                    delete request;
+                }, new LoadRequest{application, patchFilePath});
+            }
             ImGui::EndMenu();
         }
         if(ImGui::BeginMenu("Edit")){
@@ -24,7 +52,8 @@ void submit(flecs::entity application){
             Patch::iterate(application, [&](flecs::entity patch){
                 bool b_selected = selectedPatch == patch;
                 ImGui::PushID(patch.id());
-                if(ImGui::MenuItem(patch.name().c_str(), "", b_selected)){
+                //every active patch is sent, selecting one only changes what is displayed
+                if(ImGui::MenuItem(patch.name().c_str(), Patch::isActive(patch) ? "" : "inactive", b_selected)){
                     Patch::select(application, patch);
                 }
                 ImGui::PopID();
@@ -65,10 +94,31 @@ void submit(flecs::entity application){
 
             if(selectedFixture.has<Fixture::Layout>()){                
                 Fixture::Layout f = selectedFixture.get<Fixture::Layout>();
+                const auto* channelFormat = selectedFixture.try_get<Fixture::ChannelFormat>();
                 bool edited = false;
                 ImGui::SeparatorText("Fixture");
                 edited |= ImGui::InputInt("Pixel Count", &f.pixelCount);
+
+                const char* formatName = channelFormat ? Fixture::getChannelOrderName(channelFormat->order) : "Default";
+                if(ImGui::BeginCombo("Channel Format", formatName)){
+                    if(ImGui::Selectable("Default", channelFormat == nullptr)){
+                        selectedFixture.remove<Fixture::ChannelFormat>();
+                        edited = true;
+                    }
+                    for(int i = 0; i < (int)Fixture::ChannelOrder::Count; i++){
+                        auto order = Fixture::ChannelOrder(i);
+                        bool b_selected = channelFormat && channelFormat->order == order;
+                        if(ImGui::Selectable(Fixture::getChannelOrderName(order), b_selected)){
+                            selectedFixture.set<Fixture::ChannelFormat>({order});
+                            f = selectedFixture.get<Fixture::Layout>();
+                        }
+                    }
+                    ImGui::EndCombo();
+                }
+                ImGui::BeginDisabled(channelFormat != nullptr);
                 edited |= ImGui::InputInt("Color Channels", &f.channelsPerPixel);
+                ImGui::EndDisabled();
+
                 ImGui::Text("%i Bytes", f.pixelCount * f.channelsPerPixel);
                 if(edited) selectedFixture.set<Fixture::Layout>(f);
             }
@@ -136,8 +186,10 @@ void submit(flecs::entity application){
                         uint32_t fixtureColor = 0xFF0000FF;
                         if(fixture == selectedFixture) fixtureColor = 0xFF00FFFF;
 
+                        //outlines off screen are skipped, large patches mostly aren't in view when zoomed in
                         if(currentShapeType == fixture.world().id<Shape::Line>()){
                             const Shape::Line& l = fixture.get<Fixture::WithShape, Shape::Line>();
+                            if(!canvas.isVisible(glm::min(l.start, l.end), glm::max(l.start, l.end), 5.0f)) return;
                             drawing->AddLine(
                                 canvas.canvasToScreen(l.start),
                                 canvas.canvasToScreen(l.end),
@@ -145,6 +197,7 @@ void submit(flecs::entity application){
                         }
                         else if(currentShapeType == fixture.world().id<Shape::Circle>()){
                             const Shape::Circle& c = fixture.get<Fixture::WithShape, Shape::Circle>();
+                            if(!canvas.isVisible(c.center - glm::vec2(c.radius), c.center + glm::vec2(c.radius), 5.0f)) return;
                             drawing->AddCircle(
                                 canvas.canvasToScreen(c.center),
                                 canvas.canvasSizeToScreenSize(c.radius),
@@ -154,21 +207,45 @@ void submit(flecs::entity application){
                         }
                 });
     
-                Fixture::iterateWithPixelData(selectedPatch, 
-                    [&](flecs::entity fixture, Fixture::PixelData& pixelData){
-                        if(pixelData.colors.size() != pixelData.positions.size()) return;
-                        for(int i = 0; i < pixelData.colors.size(); i++){
-                            const auto& pos = pixelData.positions[i];
-                            const auto& col = pixelData.colors[i];
-                            drawing->AddCircleFilled(
-                                canvas.canvasToScreen(pos),
-                                4.0f,
-                                IM_COL32(col.r, col.g, col.b, 255));
-                        }
-                });
+                const auto* store = selectedPatch.try_get<Patch::PixelStore>();
+                const auto* index = selectedPatch.try_get<Patch::SpatialIndex>();
+                bool b_indexed = store && index && index->pixelCell.size() == store->colors.size();
+                if(store){
+                    //zoomed in, only the pixels in the cells on screen are looked at instead of the whole store
+                    glm::vec2 canvasArea = canvas.canvasSize;
+                    const auto* renderArea = selectedPatch.try_get<Patch::RenderArea>();
+                    bool b_zoomedIn = renderArea && canvasArea.x * canvasArea.y * 4.0f < (renderArea->max.x - renderArea->min.x) * (renderArea->max.y - renderArea->min.y);
+                    auto getColor = [store](size_t i){
+                        const auto& col = store->colors[i];
+                        return IM_COL32(col.r, col.g, col.b, 255);
+                    };
+                    if(b_indexed && b_zoomedIn){
+                        glm::vec2 margin = glm::vec2(canvas.screenSizeToCanvasSize(4.0f));
+                        visiblePixels.clear();
+                        Render::findPixelsInRect(*index, *store, canvas.canvasMin - margin, canvas.canvasMax + margin, visiblePixels);
+                        canvas.drawPoints(visiblePixels.size(), visiblePixels.data(), store->x.data(), store->y.data(), 4.0f, getColor);
+                    }
+                    else canvas.drawPoints(store->colors.size(), nullptr, store->x.data(), store->y.data(), 4.0f, getColor);
+                }
 
-                //double click to add fixtures
+                //click picks the fixture of the closest pixel, a shift drag picks the fixture with the most pixels in the rectangle
                 glm::vec2 canvasClickPos;
+                glm::vec2 selectionMin, selectionMax;
+                if(b_indexed && canvas.isClicked(canvasClickPos)){
+                    int64_t pixel = Render::findNearestPixel(*index, *store, canvasClickPos, canvas.screenSizeToCanvasSize(8.0f));
+                    flecs::entity fixture = pixel >= 0 ? Fixture::findByPixel(selectedPatch, uint32_t(pixel)) : flecs::entity::null();
+                    if(fixture.is_valid()) Fixture::select(selectedPatch, fixture);
+                }
+                if(b_indexed && canvas.getSelection(selectionMin, selectionMax)){
+                    visiblePixels.clear();
+                    Render::findPixelsInRect(*index, *store, selectionMin, selectionMax, visiblePixels);
+                    std::sort(visiblePixels.begin(), visiblePixels.end());
+                    flecs::entity fixture = Fixture::findByMostPixels(selectedPatch, visiblePixels);
+                    if(fixture.is_valid()) Fixture::select(selectedPatch, fixture);
+                }
+                canvas.drawSelection(0xFF00FFFF);
+
+                //double click to add fixtures
                 if (canvas.isDoubleClicked(canvasClickPos)) {
                     Fixture::createLine(selectedPatch, canvasClickPos, canvasClickPos + glm::vec2(100, 100));
                 }
@@ -289,6 +366,132 @@ void submit(flecs::entity application){
 
     }
     ImGui::End();
+
+
+    if(ImGui::Begin("Effect")){
+        auto* effect = selectedPatch.is_valid() ? selectedPatch.try_get<Patch::Effect>() : nullptr;
+        if(effect && effect->graph){
+            Render::EffectGraph& graph = *effect->graph;
+            //presets replace the whole graph, it is recompiled before the next render
+            if(ImGui::BeginCombo("Preset", "Load...")){
+                if(ImGui::Selectable("Ripple")) graph = Render::createRippleEffect();
+                if(ImGui::Selectable("Layered")) graph = Render::createLayeredEffect();
+                ImGui::EndCombo();
+            }
+            //parameters are read by the kernels while rendering, editing them doesn't recompile
+            for(int node = 0; node < graph.getNodeCount(); node++){
+                ImGui::PushID(node);
+                Render::EffectNodeType type = graph.getNodeType(node);
+                Render::EffectParameters& p = graph.getParameters(node);
+                int inputCount = Render::getEffectNodeInputCount(type);
+                ImGui::SeparatorText(Render::getEffectNodeTypeName(type));
+                if(node == graph.getOutput()){
+                    ImGui::SameLine();
+                    ImGui::TextDisabled("(output)");
+                }
+                if(inputCount > 0){
+                    ImGui::Text("Node %i  inputs:", node);
+                    for(int i = 0; i < inputCount; i++){
+                        ImGui::SameLine();
+                        ImGui::Text("%i", graph.getNodeInput(node, i));
+                    }
+                }
+                switch(type){
+                    case Render::EffectNodeType::Solid:
+                        ImGui::ColorEdit3("Color", &p.colorA.x);
+                        break;
+                    case Render::EffectNodeType::Gradient:
+                        ImGui::ColorEdit3("Color A", &p.colorA.x);
+                        ImGui::ColorEdit3("Color B", &p.colorB.x);
+                        ImGui::DragFloat2("Direction", &p.direction.x, 0.01f);
+                        ImGui::DragFloat("Scale", &p.scale, 1.0f, 1.0f, 10000.0f);
+                        ImGui::DragFloat("Speed", &p.speed, 1.0f);
+                        break;
+                    case Render::EffectNodeType::Ripple:
+                        ImGui::ColorEdit3("Color A", &p.colorA.x);
+                        ImGui::ColorEdit3("Color B", &p.colorB.x);
+                        ImGui::DragFloat("Scale", &p.scale, 0.5f, 1.0f, 10000.0f);
+                        ImGui::DragFloat("Speed", &p.speed, 1.0f);
+                        break;
+                    case Render::EffectNodeType::Brightness:
+                        ImGui::SliderFloat("Amount", &p.amount, 0.0f, 2.0f);
+                        break;
+                    case Render::EffectNodeType::Pulse:
+                        ImGui::SliderFloat("Depth", &p.amount, 0.0f, 1.0f);
+                        ImGui::DragFloat("Speed", &p.speed, 0.01f, 0.0f, 50.0f, "%.2fHz");
+                        break;
+                    default:
+                        ImGui::SliderFloat("Amount", &p.amount, 0.0f, 1.0f);
+                        break;
+                }
+                ImGui::PopID();
+            }
+        }
+        else ImGui::TextDisabled("No effect on the selected patch");
+    }
+    ImGui::End();
+
+
+    if(ImGui::Begin("Artnet Output")){
+        if(selectedPatch.is_valid()){
+            Patch::Settings settings = selectedPatch.get<Patch::Settings>();
+            if(ImGui::Checkbox("Active", &settings.b_active)){
+                selectedPatch.set<Patch::Settings>(settings);
+            }
+            if(ImGui::InputFloat("Refresh Rate", &settings.refreshRate, 1.0, 10.0, "%.1fHz")){
+                selectedPatch.set<Patch::Settings>(settings);
+            }
+            if(ImGui::InputFloat("Keep Alive", &settings.keepAliveInterval, 0.1, 1.0, "%.1fs")){
+                selectedPatch.set<Patch::Settings>(settings);
+            }
+            const auto* output = selectedPatch.try_get<Patch::ArtnetOutput>();
+            if(output && output->engine){
+                auto stats = output->engine->getTimingStatistics();
+                ImGui::SeparatorText("Frame Timing");
+                ImGui::Text("Universes: %i", (int)output->engine->getRouteCount());
+                ImGui::Text("Interval min: %.3fms", stats.minInterval);
+                ImGui::Text("Interval max: %.3fms", stats.maxInterval);
+                ImGui::Text("Interval avg: %.3fms", stats.averageInterval);
+                ImGui::Text("Interval p99: %.3fms", stats.p99Interval);
+                ImGui::Text("Frames: %llu (%llu missed)",
+                    (unsigned long long)stats.frameCount,
+                    (unsigned long long)stats.missedFrames);
+                auto sending = output->engine->getSendStatistics();
+                ImGui::Text("Send time avg: %.3fms max: %.3fms", sending.averageSendTime, sending.maxSendTime);
+                ImGui::Text("Packets: %.0f/s (%.0f/s unchanged skipped, %.0f/s dropped)", sending.packetRate, sending.skippedRate, sending.droppedRate);
+            }
+
+            ImGui::SeparatorText("Devices");
+            Artnet::Device::iterate(selectedPatch, [](flecs::entity device, Artnet::Device::IpAddress& ip, Artnet::Device::UniverseRange& range){
+                ImGui::PushID(device.id());
+                bool b_sync = Artnet::Device::isSyncEnabled(device);
+                if(ImGui::Checkbox("##Sync", &b_sync)) device.set<Artnet::Device::Options>({b_sync});
+                ImGui::SameLine();
+                ImGui::Text("%s  %i.%i.%i.%i  universes %i-%i  ArtSync", device.name().c_str(),
+                    int(ip.address >> 24), int((ip.address >> 16) & 0xFF), int((ip.address >> 8) & 0xFF), int(ip.address & 0xFF),
+                    int(range.first), int(range.first + range.count - 1));
+                ImGui::PopID();
+            });
+
+            ImGui::SeparatorText("Input");
+            const auto* input = selectedPatch.try_get<Patch::ArtnetInput>();
+            const char* mergeName = input ? Artnet::getMergeModeName(input->mode) : "Off";
+            if(ImGui::BeginCombo("Merge", mergeName)){
+                if(ImGui::Selectable("Off", input == nullptr)) Patch::disableArtnetInput(selectedPatch);
+                for(int i = 0; i < (int)Artnet::MergeMode::Count; i++){
+                    auto mode = Artnet::MergeMode(i);
+                    bool b_selected = input && input->mode == mode;
+                    if(ImGui::Selectable(Artnet::getMergeModeName(mode), b_selected)) Patch::enableArtnetInput(selectedPatch, mode);
+                }
+                ImGui::EndCombo();
+            }
+            if(input && input->engine){
+                if(!input->engine->isOpen()) ImGui::TextColored(ImVec4(1.0, 0.3, 0.3, 1.0), "Could not open port %i", (int)Artnet::UdpPort);
+                ImGui::Text("Packets received: %llu", (unsigned long long)input->engine->getPacketCount());
+            }
+        }
+    }
+    ImGui::End();
 }
 
 
@@ -0,0 +1,917 @@
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PixelMapper.h"
+#include "artnet/ArtnetOutput.h"
+#include "artnet/DmxMerge.h"
+#include "artnet/PixelPacking.h"
+#include "file/PatchFile.h"
+#include "render/Bounds.h"
+#include "render/EffectGraph.h"
+#include "render/FrameSource.h"
+#include "render/SharedFrameRing.h"
+#include "utils/FrameScheduler.h"
+#include "utils/Simd.h"
+#include "utils/ThreadPool.h"
+
+//runs the render and art-net pipeline without a window, opengl context or imgui
+//the app is controlled through the flecs rest endpoint (flecs explorer or plain http)
+//usage: PixelMapperHeadless [--load file] [--save file] [--video file WxH] [--images pattern n] [--shm name] [--rate hz] [--frames n]
+//       PixelMapperHeadless --produce name WxH [--rate hz]
+//       PixelMapperHeadless --bench-output universes [--rate hz]
+//       PixelMapperHeadless --verify-output universes [--rate hz]
+//       PixelMapperHeadless --bench-effects pixels
+//       PixelMapperHeadless --bench-packing pixels
+//       PixelMapperHeadless --check-merge
+//       PixelMapperHeadless --check-bounds
+//       PixelMapperHeadless --check-dmx-map
+//       PixelMapperHeadless --bench-layout pixels
+//       PixelMapperHeadless --bench-patchfile fixtures
+//  --load    loads a patch file (.xml or binary) instead of the demo patches
+//  --save    saves the selected patch before running, with --frames 0 it only converts
+//  --video   plays a raw rgba file of WxH frames on the selected patch
+//  --images  plays a printf style numbered sequence of n ppm images on the selected patch (frame_%04d.ppm)
+//  --shm     plays frames from a shared memory frame ring on the selected patch, prints publish to render and send latency
+//  --produce runs as a test producer instead, publishing a moving gradient into a shared memory frame ring
+//  --bench-output sends n universes to 127.0.0.1 for 5 seconds (default 1000Hz) and prints packets/s and send time per frame
+//  --verify-output sends n universes to a socket on 127.0.0.1:6454 for 3 seconds and checks every received packet
+//                  against the published channels (header, length, sequence, SubUni/Net, data), exits 1 on a mismatch
+//  --bench-effects renders the layered effect on n random pixels for 200 frames and prints the time per frame
+//  --bench-packing checks every pack kernel against the scalar one, exits 1 on a mismatch, then times them on n pixels
+//  --check-merge checks the htp and ltp merge kernels against plain loops on random channels, exits 1 on a mismatch
+//  --check-bounds checks the vectorized min/max reduction against a plain loop, exits 1 on a mismatch
+//  --check-dmx-map moves fixture addresses and checks each partial output plan update against a full rebuild, exits 1 on a mismatch
+//  --bench-layout times the per pixel work of a frame on the pixel store against per fixture vectors, on n pixels
+//  --bench-patchfile saves n generated fixtures as binary and xml, times loading each format and checks that the loaded
+//                    fixtures (count, layouts, addresses, shapes) match, exits 1 on a mismatch
+//  --rate    overrides the render rate, by default the highest refresh rate of the active patches
+//  --frames  renders n frames as fast as possible, prints timing and exits (throughput benchmark)
+
+static std::atomic<bool> running = true;
+
+static void onSignal(int){ running = false; }
+
+//stand in for a media server, to measure the shared memory path locally
+static int runProducer(const char* name, int width, int height, double rate){
+    PixelMapper::Render::SharedFrameProducer producer;
+    if(!producer.create(name, width, height)){
+        std::cerr << "could not create shared frame ring " << name << std::endl;
+        return 1;
+    }
+    std::cout << "producing " << width << "x" << height << " frames into " << name << std::endl;
+    FrameScheduler scheduler(rate > 0.0 ? rate : 60.0);
+    uint32_t frame = 0;
+    while(running){
+        scheduler.waitForNextFrame();
+        uint8_t* pixels = producer.beginFrame();
+        for(int y = 0; y < height; y++){
+            for(int x = 0; x < width; x++){
+                uint8_t* pixel = pixels + (size_t(y) * width + x) * 4;
+                pixel[0] = uint8_t(x * 255 / width + frame);
+                pixel[1] = uint8_t(y * 255 / height);
+                pixel[2] = uint8_t(frame * 2);
+                pixel[3] = 255;
+            }
+        }
+        producer.publishFrame();
+        frame++;
+    }
+    return 0;
+}
+
+//output path on its own, no ecs: route n universes to loopback and let the engine send at its maximum rate
+static int runOutputBenchmark(int universeCount, double rate){
+    if(universeCount <= 0) return 1;
+    std::vector<PixelMapper::Artnet::OutputEngine::Route> routes;
+    std::vector<uint8_t> channels(size_t(universeCount) * PixelMapper::Artnet::DmxMaxLength);
+    uint32_t loopback = PixelMapper::Artnet::Device::makeIpAddress(127, 0, 0, 1);
+    for(int i = 0; i < universeCount; i++){
+        routes.push_back({loopback, uint16_t(i), uint16_t(PixelMapper::Artnet::DmxMaxLength), channels.data() + size_t(i) * PixelMapper::Artnet::DmxMaxLength});
+    }
+    PixelMapper::Artnet::OutputEngine engine;
+    engine.setRoutes(routes, {loopback});
+    engine.setRefreshRate(rate > 0.0 ? rate : 1000.0);
+    engine.setKeepAliveInterval(0.0); //every universe every frame, this measures throughput, not change detection
+    engine.publish();
+    std::cout << "sending " << universeCount << " universes + 1 sync per frame to 127.0.0.1" << std::endl;
+    for(int second = 0; second < 5 && running; second++){
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        for(auto& channel : channels) channel++;
+        engine.publish();
+        auto sending = engine.getSendStatistics();
+        auto timing = engine.getTimingStatistics();
+        std::cout << sending.packetRate << " packets/s (" << sending.skippedRate << " unchanged skipped, " << sending.droppedRate << " dropped), send time avg " << sending.averageSendTime
+                  << "ms max " << sending.maxSendTime << "ms per frame, publish to send avg " << sending.averageLatency
+                  << "ms max " << sending.maxLatency << "ms, "
+                  << timing.averageInterval << "ms frame interval (" << timing.missedFrames << " missed)" << std::endl;
+    }
+    return 0;
+}
+
+//output path checked from the receiving side: route n universes to a socket listening on 127.0.0.1 and compare every
+//received ArtDmx packet with the channels that were published, universe ids are spread to use the Net byte and the
+//lengths vary. Channel c of route i in frame f is f + i * 3 + c, so each packet tells which frame it belongs to
+static int runOutputVerification(int universeCount, double rate){
+    using namespace PixelMapper::Artnet;
+    if(universeCount <= 0 || universeCount > 32768) return 1;
+
+    asio::io_context ioContext;
+    asio::ip::udp::socket receiver(ioContext);
+    asio::error_code error;
+    receiver.open(asio::ip::udp::v4(), error);
+    if(!error) receiver.set_option(asio::socket_base::reuse_address(true), error);
+    if(!error) receiver.set_option(asio::socket_base::receive_buffer_size(4 * 1024 * 1024), error);
+    if(!error) receiver.bind(asio::ip::udp::endpoint(asio::ip::address_v4::loopback(), UdpPort), error);
+    if(!error) receiver.non_blocking(true, error);
+    if(error){
+        std::cerr << "could not listen on 127.0.0.1:" << UdpPort << ": " << error.message() << std::endl;
+        return 1;
+    }
+
+    std::vector<OutputEngine::Route> routes;
+    std::vector<uint8_t> channels(size_t(universeCount) * DmxMaxLength);
+    std::vector<int> routeOfUniverse(32768, -1);
+    uint32_t loopback = Device::makeIpAddress(127, 0, 0, 1);
+    for(int i = 0; i < universeCount; i++){
+        uint16_t universeId = uint16_t(size_t(i) * 131 % 32768); //131 is odd, so the ids are unique
+        uint16_t length = getDmxLength(1 + size_t(i) * 37 % DmxMaxLength);
+        routes.push_back({loopback, universeId, length, channels.data() + size_t(i) * DmxMaxLength});
+        routeOfUniverse[universeId] = i;
+    }
+    auto fillFrame = [&](uint8_t frame){
+        for(int i = 0; i < universeCount; i++){
+            uint8_t* universe = channels.data() + size_t(i) * DmxMaxLength;
+            for(size_t c = 0; c < DmxMaxLength; c++) universe[c] = uint8_t(frame + i * 3 + c);
+        }
+    };
+
+    OutputEngine engine;
+    engine.setRoutes(routes, {loopback});
+    engine.setRefreshRate(rate > 0.0 ? rate : 44.0);
+    engine.setKeepAliveInterval(0.0); //every universe every frame, so each burst has to be complete
+    uint8_t publishedFrame = 0;
+    fillFrame(publishedFrame);
+    engine.publish();
+    std::cout << "verifying " << universeCount << " universes sent to 127.0.0.1:" << UdpPort << std::endl;
+
+    uint64_t validPackets = 0, invalidPackets = 0, syncCount = 0, completeFrames = 0, incompleteFrames = 0, sequenceErrors = 0;
+    std::vector<bool> seen(universeCount, false);
+    int burstPackets = 0;
+    int burstSequence = -1;     //sequence of the dmx packets since the last sync
+    int burstFrame = -1;        //published frame of the dmx packets since the last sync
+    bool b_burstValid = true;
+    int lastSequence = -1;
+    auto reject = [&](const char* reason, const uint8_t* packet){
+        if(invalidPackets < 10) std::cout << "invalid packet: " << reason << " (universe " << int(packet[14] | (packet[15] << 8)) << ")" << std::endl;
+        invalidPackets++;
+        b_burstValid = false;
+    };
+
+    uint8_t packet[1024];
+    auto start = std::chrono::steady_clock::now();
+    auto lastPublish = start;
+    while(running && std::chrono::steady_clock::now() - start < std::chrono::seconds(3)){
+        if(std::chrono::steady_clock::now() - lastPublish > std::chrono::milliseconds(20)){
+            lastPublish = std::chrono::steady_clock::now();
+            fillFrame(++publishedFrame);
+            engine.publish();
+        }
+        asio::ip::udp::endpoint sender;
+        size_t size = receiver.receive_from(asio::buffer(packet, sizeof(packet)), sender, 0, error);
+        if(error == asio::error::would_block){
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+        if(error || size < 12 || std::memcmp(packet, "Art-Net", 8) != 0){
+            if(invalidPackets < 10) std::cout << "invalid packet: not art-net" << std::endl;
+            invalidPackets++;
+            continue;
+        }
+        uint16_t opCode = uint16_t(packet[8] | (packet[9] << 8));
+        uint16_t version = uint16_t((packet[10] << 8) | packet[11]);
+        if(version != ProtocolVersion){
+            reject("wrong protocol version", packet);
+            continue;
+        }
+        if(opCode == OpSync){
+            //a sync ends the frame, every route must have been received with one sequence number
+            if(size != SyncPacketSize) reject("wrong sync size", packet);
+            syncCount++;
+            if(burstPackets == universeCount && b_burstValid) completeFrames++;
+            else incompleteFrames++;
+            if(burstSequence != -1 && lastSequence != -1 && burstSequence != (lastSequence == 255 ? 1 : lastSequence + 1)) sequenceErrors++;
+            if(burstSequence != -1) lastSequence = burstSequence;
+            burstPackets = 0;
+            burstSequence = -1;
+            burstFrame = -1;
+            b_burstValid = true;
+            continue;
+        }
+        if(opCode != OpDmx){
+            reject("unexpected opcode", packet);
+            continue;
+        }
+        if(size < DmxHeaderSize){
+            reject("truncated header", packet);
+            continue;
+        }
+        uint16_t universeId = uint16_t(packet[14] | ((packet[15] & 0x7F) << 8));
+        uint16_t length = uint16_t((packet[16] << 8) | packet[17]);
+        int route = routeOfUniverse[universeId];
+        if(packet[15] & 0x80){ reject("net byte above 7 bits", packet); continue; }
+        if(route < 0){ reject("unknown universe", packet); continue; }
+        if(length != routes[route].length){ reject("wrong length field", packet); continue; }
+        if(size != DmxHeaderSize + length){ reject("length field doesn't match the packet size", packet); continue; }
+        if(packet[12] == 0){ reject("sequence 0", packet); continue; }
+        if(burstSequence == -1) burstSequence = packet[12];
+        else if(packet[12] != burstSequence){ reject("sequence changed within a frame", packet); continue; }
+        const uint8_t* data = packet + DmxHeaderSize;
+        uint8_t frame = uint8_t(data[0] - route * 3);
+        bool b_dataValid = true;
+        for(size_t c = 0; c < length; c++) b_dataValid &= data[c] == uint8_t(frame + route * 3 + c);
+        if(!b_dataValid){ reject("channels don't match the published frame", packet); continue; }
+        if(burstFrame == -1) burstFrame = frame;
+        else if(frame != burstFrame){ reject("channels of two published frames in one frame", packet); continue; }
+        seen[route] = true;
+        burstPackets++;
+        validPackets++;
+    }
+
+    int seenCount = int(std::count(seen.begin(), seen.end(), true));
+    std::cout << validPackets << " valid, " << invalidPackets << " invalid packets, "
+              << seenCount << "/" << universeCount << " universes received, " << syncCount << " syncs, "
+              << completeFrames << " complete frames, " << incompleteFrames << " incomplete, "
+              << sequenceErrors << " sequence errors" << std::endl;
+    bool b_passed = invalidPackets == 0 && seenCount == universeCount && completeFrames > 0 && incompleteFrames == 0 && sequenceErrors == 0;
+    std::cout << (b_passed ? "passed" : "failed") << std::endl;
+    return b_passed ? 0 : 1;
+}
+
+//pixel packing on its own: every channel order through every vector kernel the cpu supports, checked byte for byte
+//against the scalar kernel (including the tails and the bytes past the span), then timed on n pixels
+static int runPackingBenchmark(int pixelCount){
+    using namespace PixelMapper::Artnet;
+    using PixelMapper::Fixture::ChannelOrder;
+    if(pixelCount <= 0) return 1;
+    const PackInstructionSet instructionSets[] = {PackInstructionSet::Scalar, PackInstructionSet::Ssse3, PackInstructionSet::Avx2};
+    const char* instructionSetNames[] = {"Scalar", "SSSE3", "AVX2"};
+    constexpr uint8_t Guard = 0xA5;
+
+    std::mt19937 random(1);
+    std::vector<PixelMapper::ColorRGBW> colors(std::max(pixelCount, 256));
+    for(auto& color : colors) color = {uint8_t(random()), uint8_t(random()), uint8_t(random()), uint8_t(random())};
+
+    std::cout << "selected pack kernels: " << getPackingInstructionSet() << std::endl;
+    int mismatches = 0;
+    std::vector<uint8_t> expected, packed;
+    for(int o = 0; o < int(ChannelOrder::Count); o++){
+        ChannelOrder order = ChannelOrder(o);
+        const PackFormat& format = getPackFormat(order);
+        for(int s = 1; s < 3; s++){
+            PackKernel kernel = getPackKernel(format, instructionSets[s]);
+            if(!kernel) continue;
+            //every tail length of the 4, 8, 16 and 32 pixel loops, at every source alignment of a few pixels
+            for(size_t count = 0; count <= 100; count++){
+                for(size_t offset = 0; offset < 4; offset++){
+                    size_t size = count * format.channelCount;
+                    expected.assign(size + 64, Guard);
+                    packed.assign(size + 64, Guard);
+                    getPackKernel(format, PackInstructionSet::Scalar)(colors.data() + offset, expected.data(), count, format);
+                    kernel(colors.data() + offset, packed.data(), count, format);
+                    if(packed != expected){
+                        if(mismatches < 10){
+                            auto first = std::mismatch(packed.begin(), packed.end(), expected.begin()).first - packed.begin();
+                            std::cout << "mismatch: " << PixelMapper::Fixture::getChannelOrderName(order) << " " << instructionSetNames[s]
+                                      << " " << count << " pixels at offset " << offset << ", first wrong byte " << first
+                                      << (size_t(first) >= size ? " (written past the span)" : "") << std::endl;
+                        }
+                        mismatches++;
+                    }
+                }
+            }
+        }
+    }
+    std::cout << (mismatches == 0 ? "all kernels match the scalar kernel" : "kernels don't match the scalar kernel") << std::endl;
+
+    constexpr int Repeats = 200;
+    packed.resize(size_t(pixelCount) * 8);
+    for(int o = 0; o < int(ChannelOrder::Count); o++){
+        ChannelOrder order = ChannelOrder(o);
+        const PackFormat& format = getPackFormat(order);
+        std::cout << PixelMapper::Fixture::getChannelOrderName(order) << ":";
+        for(int s = 0; s < 3; s++){
+            PackKernel kernel = getPackKernel(format, instructionSets[s]);
+            if(!kernel) continue;
+            auto start = std::chrono::steady_clock::now();
+            for(int repeat = 0; repeat < Repeats; repeat++) kernel(colors.data(), packed.data(), pixelCount, format);
+            double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            std::cout << " " << instructionSetNames[s] << " " << nanoseconds / (double(Repeats) * pixelCount) << "ns/pixel";
+        }
+        std::cout << std::endl;
+    }
+    return mismatches == 0 ? 0 : 1;
+}
+
+//art-net merge kernels on their own: htp and ltp (several frames, so the ownership state carries over) against
+//plain per channel loops, byte for byte on random buffers of every tail length of the 16 channel vector loop
+static int runMergeCheck(){
+    using namespace PixelMapper::Artnet;
+    std::cout << "merge kernels: " << PIXELMAPPER_SIMD_NAME << std::endl;
+    std::mt19937 random(1);
+    auto fill = [&](std::vector<uint8_t>& buffer){ for(auto& value : buffer) value = uint8_t(random()); };
+    //changes a few channels, so ltp sees both unchanged and changed channels on either side
+    auto touch = [&](std::vector<uint8_t>& buffer){ for(auto& value : buffer) if(random() % 4 == 0) value = uint8_t(random()); };
+
+    int mismatches = 0;
+    auto check = [&](const char* mode, size_t count, int frame, const std::vector<uint8_t>& result, const std::vector<uint8_t>& expected){
+        if(result == expected) return;
+        if(mismatches < 10){
+            auto first = std::mismatch(result.begin(), result.end(), expected.begin()).first - result.begin();
+            std::cout << "mismatch: " << mode << " " << count << " channels, frame " << frame << ", first wrong byte " << first << std::endl;
+        }
+        mismatches++;
+    };
+
+    constexpr int FrameCount = 4;
+    for(size_t count = 0; count <= DmxMaxLength; count++){
+        std::vector<uint8_t> channels(count), input(count);
+        fill(channels);
+        fill(input);
+
+        std::vector<uint8_t> merged = channels, expected = channels;
+        mergeHtp(merged.data(), input.data(), count);
+        for(size_t i = 0; i < count; i++) expected[i] = std::max(expected[i], input[i]);
+        check("HTP", count, 0, merged, expected);
+
+        std::vector<uint8_t> lastPixels(count, 0), lastInput(count, 0), inputOwns(count, 0);
+        std::vector<uint8_t> expectedLastPixels = lastPixels, expectedLastInput = lastInput, expectedInputOwns = inputOwns;
+        for(int frame = 0; frame < FrameCount; frame++){
+            //the pixels and the input change independently between frames
+            if(frame > 0){
+                touch(channels);
+                touch(input);
+            }
+            merged = channels;
+            expected = channels;
+            mergeLtp(merged.data(), input.data(), lastPixels.data(), lastInput.data(), inputOwns.data(), count);
+            for(size_t i = 0; i < count; i++){
+                if(input[i] != expectedLastInput[i]) expectedInputOwns[i] = 0xFF;
+                else if(expected[i] != expectedLastPixels[i]) expectedInputOwns[i] = 0x00;
+                expectedLastPixels[i] = expected[i];
+                expectedLastInput[i] = input[i];
+                if(expectedInputOwns[i]) expected[i] = input[i];
+            }
+            check("LTP", count, frame, merged, expected);
+            check("LTP state", count, frame, inputOwns, expectedInputOwns);
+            check("LTP state", count, frame, lastPixels, expectedLastPixels);
+            check("LTP state", count, frame, lastInput, expectedLastInput);
+        }
+    }
+    std::cout << (mismatches == 0 ? "all merge kernels match the scalar loops" : "merge kernels don't match the scalar loops") << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+//min/max reduction on its own: counts around the 16 value vector loop (0, short tails, one block plus tails) at
+//a few alignments, against a plain loop. The extremes are placed at the start, the end and inside the vector blocks
+static int runBoundsCheck(){
+    std::cout << "min/max reduction: " << PIXELMAPPER_SIMD_NAME << std::endl;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> value(-1000.0f, 1000.0f);
+    std::vector<float> values(1100);
+
+    int mismatches = 0;
+    const size_t counts[] = {0, 1, 2, 3, 5, 7, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65, 100, 1000, 1027};
+    for(size_t count : counts){
+        for(size_t offset = 0; offset < 4; offset++){
+            for(int extreme = 0; extreme < 3; extreme++){
+                for(auto& v : values) v = value(random);
+                float* first = values.data() + offset;
+                if(count > 0){
+                    size_t position = extreme == 0 ? 0 : extreme == 1 ? count - 1 : count / 2;
+                    first[position] = -5000.0f;
+                    first[count - 1 - position] = 5000.0f;
+                }
+                //count 0 must leave the outputs untouched
+                float min = 12345.0f, max = -12345.0f;
+                float expectedMin = min, expectedMax = max;
+                if(count > 0){
+                    expectedMin = expectedMax = first[0];
+                    for(size_t i = 1; i < count; i++){
+                        expectedMin = std::min(expectedMin, first[i]);
+                        expectedMax = std::max(expectedMax, first[i]);
+                    }
+                }
+                PixelMapper::Render::findMinMax(first, count, min, max);
+                if(min != expectedMin || max != expectedMax){
+                    if(mismatches < 10){
+                        std::cout << "mismatch: " << count << " values at offset " << offset << ": " << min << " " << max
+                                  << ", expected " << expectedMin << " " << expectedMax << std::endl;
+                    }
+                    mismatches++;
+                }
+            }
+        }
+    }
+    std::cout << (mismatches == 0 ? "the reduction matches the scalar loop" : "the reduction doesn't match the scalar loop") << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+//pixel layout on its own, one thread: the per frame work that walks every pixel (render area, a position based
+//effect, packing into universes) on the PixelStore structure of arrays against the previous layout, where every
+//fixture owned its own position and color vectors. Fixtures have 170 rgb pixels (one universe)
+static int runLayoutBenchmark(int pixelCount){
+    using namespace PixelMapper;
+    constexpr int FixturePixels = 170;
+    int fixtureCount = (pixelCount + FixturePixels - 1) / FixturePixels;
+    if(fixtureCount <= 0) return 1;
+    pixelCount = fixtureCount * FixturePixels;
+    const Artnet::PackFormat& format = Artnet::getDefaultPackFormat(3);
+    std::vector<uint8_t> universes(size_t(fixtureCount) * Artnet::DmxMaxLength);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(0.0f, 1000.0f);
+
+    //previous layout, allocated one fixture after the other like a loaded patch, with the other allocations of
+    //fixture creation in between
+    struct PixelData{
+        std::vector<glm::vec3> positions;
+        std::vector<ColorRGBW> colors;
+    };
+    std::vector<std::unique_ptr<PixelData>> fixtures;
+    std::vector<std::unique_ptr<uint8_t[]>> clutter;
+    for(int f = 0; f < fixtureCount; f++){
+        auto data = std::make_unique<PixelData>();
+        data->positions.resize(FixturePixels);
+        clutter.push_back(std::make_unique<uint8_t[]>(64 + random() % 512));
+        data->colors.resize(FixturePixels);
+        clutter.push_back(std::make_unique<uint8_t[]>(64 + random() % 512));
+        for(auto& p : data->positions) p = glm::vec3(position(random), position(random), 0.0f);
+        fixtures.push_back(std::move(data));
+    }
+
+    //current layout, same positions
+    Patch::PixelStore store;
+    std::vector<Fixture::PixelRange> ranges;
+    for(auto& data : fixtures){
+        ranges.push_back({uint32_t(store.x.size()), uint32_t(FixturePixels)});
+        for(auto& p : data->positions){
+            store.x.push_back(p.x);
+            store.y.push_back(p.y);
+            store.z.push_back(p.z);
+        }
+    }
+    store.colors.resize(store.x.size());
+
+    auto shade = [](float x, float y, int frame){
+        return ColorRGBW{uint8_t(x * 0.25f), uint8_t(y * 0.25f), uint8_t((x + y) * 0.125f + frame), 0};
+    };
+
+    constexpr int FrameCount = 200;
+    auto runFrames = [&](auto&& frameFn){
+        double sum = 0.0;
+        for(int frame = 0; frame < FrameCount && running; frame++){
+            auto start = std::chrono::steady_clock::now();
+            frameFn(frame);
+            sum += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        return sum / FrameCount;
+    };
+    glm::vec3 areaMin, areaMax;
+
+    double perFixture = runFrames([&](int frame){
+        areaMin = glm::vec3(FLT_MAX);
+        areaMax = glm::vec3(-FLT_MAX);
+        for(auto& data : fixtures){
+            for(auto& p : data->positions){
+                areaMin = glm::min(areaMin, p);
+                areaMax = glm::max(areaMax, p);
+            }
+        }
+        for(auto& data : fixtures){
+            for(size_t i = 0; i < data->positions.size(); i++) data->colors[i] = shade(data->positions[i].x, data->positions[i].y, frame);
+        }
+        for(size_t f = 0; f < fixtures.size(); f++){
+            Artnet::packPixels(fixtures[f]->colors.data(), universes.data() + f * Artnet::DmxMaxLength, FixturePixels, format);
+        }
+    });
+    uint64_t perFixtureChecksum = 0;
+    for(uint8_t channel : universes) perFixtureChecksum += channel;
+
+    double structureOfArrays = runFrames([&](int frame){
+        areaMin = glm::vec3(FLT_MAX);
+        areaMax = glm::vec3(-FLT_MAX);
+        Render::findMinMax(store.x.data(), store.x.size(), areaMin.x, areaMax.x);
+        Render::findMinMax(store.y.data(), store.y.size(), areaMin.y, areaMax.y);
+        Render::findMinMax(store.z.data(), store.z.size(), areaMin.z, areaMax.z);
+        for(size_t i = 0; i < store.colors.size(); i++) store.colors[i] = shade(store.x[i], store.y[i], frame);
+        for(size_t f = 0; f < ranges.size(); f++){
+            Artnet::packPixels(store.colors.data() + ranges[f].offset, universes.data() + f * Artnet::DmxMaxLength, ranges[f].count, format);
+        }
+    });
+    uint64_t structureOfArraysChecksum = 0;
+    for(uint8_t channel : universes) structureOfArraysChecksum += channel;
+
+    std::cout << fixtureCount << " fixtures, " << pixelCount << " pixels, avg per frame: per fixture vectors " << perFixture
+              << "ms, pixel store " << structureOfArrays << "ms (" << perFixture / structureOfArrays << "x)" << std::endl;
+    if(perFixtureChecksum != structureOfArraysChecksum){
+        std::cout << "the layouts produced different channels" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+//moves one fixture at a time to a random address and checks the plan left by the partial update of UpdateDmxUniverses
+//against a forced full UpdateDmxOutputMap rebuild: same copy spans in the same order and the same universe used sizes
+static int runDmxMapCheck(){
+    using namespace PixelMapper;
+    flecs::world world;
+    App::import(world);
+    flecs::entity pixelMapper = App::get(world);
+    flecs::entity patch = Patch::create(pixelMapper);
+
+    //few universes for many fixtures, so fixtures overlap and straddle universe boundaries
+    constexpr int FixtureCount = 60;
+    constexpr int UniverseCount = 6;
+    constexpr int MoveCount = 500;
+    std::mt19937 random(1);
+    std::vector<flecs::entity> fixtures;
+    for(int f = 0; f < FixtureCount; f++){
+        flecs::entity fixture = Fixture::createLine(patch, glm::vec2(f * 10.0f, 0.0f), glm::vec2(f * 10.0f, 100.0f), 1 + random() % 200, 3 + random() % 2);
+        fixture.set<Fixture::DmxAddress>({uint16_t(random() % UniverseCount), uint16_t(random() % 512)});
+        fixtures.push_back(fixture);
+    }
+    world.progress();
+
+    struct PlanState{
+        std::vector<Artnet::CopySpan> spans;
+        std::vector<std::pair<uint16_t, uint16_t>> usedSizes; //universe id, used size
+    };
+    auto record = [&](){
+        PlanState state;
+        state.spans = patch.get<Artnet::OutputPlan>().spans;
+        for(auto& [id, universe] : patch.get<Patch::DmxUniverseMap>().universes){
+            state.usedSizes.push_back({id, universe.get<Artnet::Universe::Properties>().usedSize});
+        }
+        std::sort(state.usedSizes.begin(), state.usedSizes.end());
+        return state;
+    };
+    auto isSameSpan = [](const Artnet::CopySpan& a, const Artnet::CopySpan& b){
+        return a.source == b.source && a.universeId == b.universeId && a.destination == b.destination && a.pixelCount == b.pixelCount
+            && a.firstChannel == b.firstChannel && a.byteCount == b.byteCount && a.format == b.format;
+    };
+
+    int mismatches = 0;
+    for(int move = 0; move < MoveCount && running; move++){
+        flecs::entity fixture = fixtures[random() % fixtures.size()];
+        fixture.set<Fixture::DmxAddress>({uint16_t(random() % UniverseCount), uint16_t(random() % 512)});
+        if(patch.has<Patch::DmxMapDirty>()){
+            std::cout << "moving a fixture requested a full rebuild" << std::endl;
+            return 1;
+        }
+        world.progress();
+        PlanState partial = record();
+
+        patch.add<Patch::DmxMapDirty>();
+        world.progress();
+        PlanState full = record();
+
+        bool b_sameSpans = partial.spans.size() == full.spans.size()
+            && std::equal(partial.spans.begin(), partial.spans.end(), full.spans.begin(), isSameSpan);
+        if(!b_sameSpans || partial.usedSizes != full.usedSizes){
+            if(mismatches++ < 10){
+                std::cout << "move " << move << ": " << (b_sameSpans ? "" : "copy spans differ ")
+                          << (partial.usedSizes == full.usedSizes ? "" : "used sizes differ") << std::endl;
+            }
+        }
+    }
+    std::cout << MoveCount << " moves of " << FixtureCount << " fixtures over " << UniverseCount << " universes, "
+              << mismatches << " partial updates differ from the full rebuild" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+//saves n generated fixtures in both formats, times loading each back and checks that both loads match the patch
+static int runPatchFileBenchmark(int fixtureCount){
+    using namespace PixelMapper;
+    using PatchFile::Binary::FixtureRecord;
+    if(fixtureCount <= 0) return 1;
+
+    flecs::world world;
+    App::import(world);
+    flecs::entity pixelMapper = App::get(world);
+    flecs::entity patch = Patch::create(pixelMapper);
+
+    //random lines and circles packed one after the other into the universes, every other fixture with a channel format
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(0.0f, 1000.0f);
+    std::vector<Shape::Line> lines;
+    std::vector<Shape::Circle> circles;
+    std::vector<Fixture::Layout> lineLayouts, circleLayouts;
+    std::vector<Fixture::DmxAddress> lineAddresses, circleAddresses;
+    uint16_t universe = 0, address = 0;
+    for(int f = 0; f < fixtureCount; f++){
+        Fixture::Layout layout{int(1 + random() % 128), int(3 + random() % 2)};
+        if(address + layout.pixelCount * layout.channelsPerPixel > Artnet::DmxMaxLength){
+            universe++;
+            address = 0;
+        }
+        Fixture::DmxAddress dmx{universe, address};
+        address += layout.pixelCount * layout.channelsPerPixel;
+        if(f % 2 == 0){
+            lines.push_back({glm::vec2(position(random), position(random)), glm::vec2(position(random), position(random))});
+            lineLayouts.push_back(layout);
+            lineAddresses.push_back(dmx);
+        }
+        else{
+            circles.push_back({glm::vec2(position(random), position(random)), position(random) * 0.1f});
+            circleLayouts.push_back(layout);
+            circleAddresses.push_back(dmx);
+        }
+    }
+    std::vector<flecs::entity> fixtures = Fixture::createLines(patch, lines, lineLayouts, lineAddresses);
+    for(flecs::entity fixture : Fixture::createCircles(patch, circles, circleLayouts, circleAddresses)) fixtures.push_back(fixture);
+    for(size_t f = 0; f < fixtures.size(); f += 2){
+        int channels = fixtures[f].get<Fixture::Layout>().channelsPerPixel;
+        fixtures[f].set<Fixture::ChannelFormat>({channels == 3 ? Fixture::ChannelOrder::GRB : Fixture::ChannelOrder::GRBW});
+    }
+    Artnet::Device::create(patch, Artnet::Device::makeIpAddress(10, 0, 0, 1), 0, universe + 1);
+    world.progress();
+
+    const char* binaryPath = "bench-patchfile.pxmp";
+    const char* xmlPath = "bench-patchfile.xml";
+    if(!PatchFile::saveBinary(patch, binaryPath) || !PatchFile::saveXml(patch, xmlPath)){
+        std::cout << "could not save the patch files" << std::endl;
+        return 1;
+    }
+
+    //records sorted by fixture name, the order of the fixtures in a patch is not part of its content
+    auto collectSorted = [](flecs::entity loaded, PatchFile::Records& records){
+        if(!PatchFile::collect(loaded, records)) return false;
+        std::sort(records.fixtures.begin(), records.fixtures.end(), [&](const FixtureRecord& a, const FixtureRecord& b){
+            return std::strcmp(records.names.data() + a.name, records.names.data() + b.name) < 0;
+        });
+        return true;
+    };
+    auto matches = [](const PatchFile::Records& a, const PatchFile::Records& b){
+        if(a.fixtures.size() != b.fixtures.size() || a.devices.size() != b.devices.size()) return false;
+        for(size_t i = 0; i < a.fixtures.size(); i++){
+            const FixtureRecord& x = a.fixtures[i];
+            const FixtureRecord& y = b.fixtures[i];
+            if(std::strcmp(a.names.data() + x.name, b.names.data() + y.name) != 0) return false;
+            if(x.pixelCount != y.pixelCount || x.channelsPerPixel != y.channelsPerPixel || x.channelFormat != y.channelFormat) return false;
+            if(x.universe != y.universe || x.address != y.address) return false;
+            if(x.shapeType != y.shapeType || std::memcmp(x.shape, y.shape, sizeof(x.shape)) != 0) return false;
+        }
+        return true;
+    };
+    PatchFile::Records saved;
+    collectSorted(patch, saved);
+
+    //each load creates a new patch, the loaded patches are checked and kept until the end
+    constexpr int RunCount = 5;
+    auto timeLoads = [&](flecs::entity(*load)(flecs::entity, const char*), const char* path, const char* format){
+        double sum = 0.0, best = std::numeric_limits<double>::max();
+        bool b_match = true;
+        for(int run = 0; run < RunCount && running; run++){
+            auto start = std::chrono::steady_clock::now();
+            flecs::entity loaded = load(pixelMapper, path);
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            sum += milliseconds;
+            best = std::min(best, milliseconds);
+            PatchFile::Records records;
+            if(!loaded.is_valid() || !collectSorted(loaded, records) || !matches(saved, records)) b_match = false;
+        }
+        std::cout << format << ": avg " << sum / RunCount << "ms best " << best << "ms" << (b_match ? "" : ", does not match the saved patch") << std::endl;
+        return std::make_pair(best, b_match);
+    };
+    std::cout << "loading " << saved.fixtures.size() << " fixtures, " << RunCount << " runs" << std::endl;
+    auto [binaryTime, b_binaryMatch] = timeLoads(PatchFile::loadBinary, binaryPath, "binary");
+    auto [xmlTime, b_xmlMatch] = timeLoads(PatchFile::loadXml, xmlPath, "xml");
+    std::cout << "binary loads " << xmlTime / binaryTime << "x faster than xml" << std::endl;
+    std::remove(binaryPath);
+    std::remove(xmlPath);
+    return b_binaryMatch && b_xmlMatch ? 0 : 1;
+}
+
+//effect engine on its own, no ecs: same chunking across the thread pool as RenderEffects
+static int runEffectBenchmark(int pixelCount){
+    if(pixelCount <= 0) return 1;
+    PixelMapper::Patch::PixelStore store;
+    store.x.resize(pixelCount);
+    store.y.resize(pixelCount);
+    store.z.resize(pixelCount);
+    store.colors.resize(pixelCount);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(0.0f, 1000.0f);
+    for(int i = 0; i < pixelCount; i++){
+        store.x[i] = position(random);
+        store.y[i] = position(random);
+    }
+    PixelMapper::Render::EffectGraph graph = PixelMapper::Render::createLayeredEffect();
+    if(!graph.compile()) return 1;
+    auto& pool = ThreadPool::getShared();
+    std::cout << "rendering the layered effect on " << pixelCount << " pixels with " << pool.getThreadCount() << " threads" << std::endl;
+    constexpr int FrameCount = 200;
+    double sum = 0.0, max = 0.0;
+    for(int frame = 0; frame < FrameCount && running; frame++){
+        auto start = std::chrono::steady_clock::now();
+        pool.parallelFor(store.colors.size(), PixelMapper::Render::EffectGraph::ChunkSize,
+            [&](size_t begin, size_t end){
+                graph.render(store, glm::vec3(500.0f, 500.0f, 0.0f), float(frame) / 44.0f, begin, end);
+        });
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        sum += milliseconds;
+        max = std::max(max, milliseconds);
+    }
+    std::cout << "avg " << sum / FrameCount << "ms max " << max << "ms per frame" << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv){
+
+    const char* loadPath = nullptr;
+    const char* savePath = nullptr;
+    std::shared_ptr<PixelMapper::Render::FrameSource> videoSource;
+    std::shared_ptr<PixelMapper::Render::SharedMemorySource> sharedMemorySource;
+    const char* produceName = nullptr;
+    int produceWidth = 0, produceHeight = 0;
+    int benchmarkUniverses = 0;
+    int verifyUniverses = 0;
+    int benchmarkPixels = 0;
+    int packingPixels = 0;
+    int layoutPixels = 0;
+    int patchFileFixtures = 0;
+    bool b_checkMerge = false;
+    bool b_checkBounds = false;
+    bool b_checkDmxMap = false;
+    double rateOverride = 0.0;
+    long benchmarkFrames = -1;
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "--load") == 0 && i + 1 < argc) loadPath = argv[++i];
+        else if(std::strcmp(argv[i], "--save") == 0 && i + 1 < argc) savePath = argv[++i];
+        else if(std::strcmp(argv[i], "--video") == 0 && i + 2 < argc){
+            const char* path = argv[++i];
+            int width = 0, height = 0;
+            std::sscanf(argv[++i], "%dx%d", &width, &height);
+            auto source = std::make_shared<PixelMapper::Render::RawFileSource>(path, width, height);
+            if(!source->isOpen()){
+                std::cerr << "could not open video file " << path << std::endl;
+                return 1;
+            }
+            videoSource = source;
+        }
+        else if(std::strcmp(argv[i], "--images") == 0 && i + 2 < argc){
+            const char* pattern = argv[++i];
+            int count = std::atoi(argv[++i]);
+            std::vector<std::string> paths;
+            char path[1024];
+            for(int frame = 0; frame < count; frame++){
+                std::snprintf(path, sizeof(path), pattern, frame);
+                paths.push_back(path);
+            }
+            auto source = std::make_shared<PixelMapper::Render::ImageSequenceSource>(paths);
+            if(!source->isOpen()){
+                std::cerr << "could not load image sequence " << pattern << std::endl;
+                return 1;
+            }
+            videoSource = source;
+        }
+        else if(std::strcmp(argv[i], "--shm") == 0 && i + 1 < argc){
+            sharedMemorySource = std::make_shared<PixelMapper::Render::SharedMemorySource>(argv[++i]);
+            videoSource = sharedMemorySource;
+        }
+        else if(std::strcmp(argv[i], "--produce") == 0 && i + 2 < argc){
+            produceName = argv[++i];
+            std::sscanf(argv[++i], "%dx%d", &produceWidth, &produceHeight);
+        }
+        else if(std::strcmp(argv[i], "--bench-output") == 0 && i + 1 < argc) benchmarkUniverses = std::atoi(argv[++i]);
+        else if(std::strcmp(argv[i], "--verify-output") == 0 && i + 1 < argc) verifyUniverses = std::atoi(argv[++i]);
+        else if(std::strcmp(argv[i], "--bench-effects") == 0 && i + 1 < argc) benchmarkPixels = std::atoi(argv[++i]);
+        else if(std::strcmp(argv[i], "--bench-packing") == 0 && i + 1 < argc) packingPixels = std::atoi(argv[++i]);
+        else if(std::strcmp(argv[i], "--bench-layout") == 0 && i + 1 < argc) layoutPixels = std::atoi(argv[++i]);
+        else if(std::strcmp(argv[i], "--bench-patchfile") == 0 && i + 1 < argc) patchFileFixtures = std::atoi(argv[++i]);
+        else if(std::strcmp(argv[i], "--check-merge") == 0) b_checkMerge = true;
+        else if(std::strcmp(argv[i], "--check-bounds") == 0) b_checkBounds = true;
+        else if(std::strcmp(argv[i], "--check-dmx-map") == 0) b_checkDmxMap = true;
+        else if(std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) rateOverride = std::atof(argv[++i]);
+        else if(std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) benchmarkFrames = std::atol(argv[++i]);
+        else{
+            std::cerr << "usage: " << argv[0] << " [--load file] [--save file] [--video file WxH] [--images pattern n] [--shm name] [--rate hz] [--frames n]" << std::endl;
+            std::cerr << "       " << argv[0] << " --produce name WxH [--rate hz]" << std::endl;
+            std::cerr << "       " << argv[0] << " --bench-output universes [--rate hz]" << std::endl;
+            std::cerr << "       " << argv[0] << " --verify-output universes [--rate hz]" << std::endl;
+            std::cerr << "       " << argv[0] << " --bench-effects pixels" << std::endl;
+            std::cerr << "       " << argv[0] << " --bench-packing pixels" << std::endl;
+            std::cerr << "       " << argv[0] << " --check-merge" << std::endl;
+            std::cerr << "       " << argv[0] << " --check-bounds" << std::endl;
+            std::cerr << "       " << argv[0] << " --check-dmx-map" << std::endl;
+            std::cerr << "       " << argv[0] << " --bench-layout pixels" << std::endl;
+            std::cerr << "       " << argv[0] << " --bench-patchfile fixtures" << std::endl;
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    if(produceName) return runProducer(produceName, produceWidth, produceHeight, rateOverride);
+    if(benchmarkUniverses > 0) return runOutputBenchmark(benchmarkUniverses, rateOverride);
+    if(verifyUniverses > 0) return runOutputVerification(verifyUniverses, rateOverride);
+    if(benchmarkPixels > 0) return runEffectBenchmark(benchmarkPixels);
+    if(packingPixels > 0) return runPackingBenchmark(packingPixels);
+    if(b_checkMerge) return runMergeCheck();
+    if(b_checkBounds) return runBoundsCheck();
+    if(b_checkDmxMap) return runDmxMapCheck();
+    if(layoutPixels > 0) return runLayoutBenchmark(layoutPixels);
+    if(patchFileFixtures > 0) return runPatchFileBenchmark(patchFileFixtures);
+
+    flecs::world world;
+
+    //import our flecs modules, no gui module in headless mode
+    world.import<flecs::stats>();
+    world.set<flecs::Rest>({});
+    PixelMapper::App::import(world);
+
+    //init our app
+    auto pixelMapper = PixelMapper::App::get(world);
+    if(loadPath){
+        auto start = std::chrono::steady_clock::now();
+        flecs::entity patch = PixelMapper::PatchFile::load(pixelMapper, loadPath);
+        if(!patch.is_valid()){
+            std::cerr << "could not load patch file " << loadPath << std::endl;
+            return 1;
+        }
+        PixelMapper::Patch::select(pixelMapper, patch);
+        world.progress(); //first frame compiles the pixel store and output plan
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "loaded " << loadPath << " in " << milliseconds << "ms" << std::endl;
+    }
+    else PixelMapper::App::createDemo(pixelMapper);
+
+    if(savePath){
+        if(!PixelMapper::PatchFile::save(PixelMapper::Patch::getSelected(pixelMapper), savePath)){
+            std::cerr << "could not save patch file " << savePath << std::endl;
+            return 1;
+        }
+    }
+
+    if(videoSource){
+        PixelMapper::Patch::getSelected(pixelMapper).set<PixelMapper::Patch::VideoInput>({videoSource});
+    }
+
+    if(benchmarkFrames == 0) return 0;
+    if(benchmarkFrames > 0){
+        //unpaced, measures the cost of render + plan execution + publish per frame
+        auto start = std::chrono::steady_clock::now();
+        long frame = 0;
+        for(; frame < benchmarkFrames && running; frame++) world.progress();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << frame << " frames in " << seconds << "s, "
+                  << seconds * 1000.0 / double(std::max(frame, 1L)) << "ms/frame, "
+                  << double(frame) / seconds << " fps" << std::endl;
+        return 0;
+    }
+
+    //render at the highest refresh rate of the active patches, each output thread paces its transmission on its own
+    FrameScheduler scheduler;
+    auto lastReport = std::chrono::steady_clock::now();
+    while(running){
+        double rate = rateOverride;
+        if(rate <= 0.0){
+            PixelMapper::Patch::iterateActive(pixelMapper, [&](flecs::entity patch){
+                rate = std::max(rate, double(patch.get<PixelMapper::Patch::Settings>().refreshRate));
+            });
+        }
+        if(rate > 0.0) scheduler.setRate(rate);
+        scheduler.waitForNextFrame();
+        world.progress();
+
+        if(sharedMemorySource && std::chrono::steady_clock::now() - lastReport > std::chrono::seconds(1)){
+            lastReport = std::chrono::steady_clock::now();
+            auto latency = sharedMemorySource->getLatencyStatistics();
+            std::cout << "shm frames " << latency.frameCount
+                      << " latency avg " << latency.average << "ms max " << latency.max << "ms, "
+                      << latency.tornCount << " torn frames dropped";
+            //the engine measures from the producer publishing the frame to its packets leaving
+            const auto* output = PixelMapper::Patch::getSelected(pixelMapper).try_get<PixelMapper::Patch::ArtnetOutput>();
+            if(output && output->engine){
+                auto sending = output->engine->getSendStatistics();
+                std::cout << ", publish to send avg " << sending.averageLatency << "ms max " << sending.maxLatency << "ms";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    return 0;
+}//main()
@@ -10,6 +10,7 @@
 #define GL_SILENCE_DEPRECATION
 
 #include "PixelMapper.h"
+#include "utils/FrameScheduler.h"
 
 
 int main(){
@@ -33,7 +34,7 @@ int main(){
 
     GLFWwindow* mainWindow = glfwCreateWindow(1280, 720, "PixelMapper", nullptr, nullptr);
     glfwMakeContextCurrent(mainWindow); //enable the opengl context
-    glfwSwapInterval(1);    //enable vsync
+    glfwSwapInterval(0);    //disable vsync, frames are paced by the scheduler at the patch refresh rate
 
     if(!gladLoadGL()) return 0;
 
@@ -60,28 +61,18 @@ int main(){
 
     //init our app
     auto pixelMapper = PixelMapper::App::get(world);
-    auto patch1 = PixelMapper::Patch::create(pixelMapper);
-    auto f1 = PixelMapper::Fixture::createLine(patch1, glm::vec2(100.0, 200.0), glm::vec2(200.0, 100.0), 16, 4);
-    auto f2 = PixelMapper::Fixture::createCircle(patch1, glm::vec2(100.0, 100.0), 50.0, 32, 3);
-    PixelMapper::Fixture::setDmxProperties(f1, 0, 0);
-    PixelMapper::Fixture::setDmxProperties(f2, 0, 64);
-    auto patch2 = PixelMapper::Patch::create(pixelMapper);
-    PixelMapper::Patch::select(pixelMapper, patch1);
-    int bytes = 0;
-    int channelCount = 3;
-    for(int i = 0; i < 8; i++){
-        for(int j = 0; j < 8; j++){
-            int pixelCount = random() % 16 + 6;
-            int fixtureBytes = pixelCount * channelCount;
-            flecs::entity fixture = PixelMapper::Fixture::createCircle(patch2, glm::vec2(i*100.0 + 50.0, j*100.0 + 50), 45.0, pixelCount, channelCount);
-            int universe = bytes / 512;
-            int startAddress = bytes % 512;
-            PixelMapper::Fixture::setDmxProperties(fixture, universe, startAddress);
-            bytes += fixtureBytes;
-        }
-    }
+    PixelMapper::App::createDemo(pixelMapper);
 
+    //render at the highest refresh rate of the active patches, each output thread paces its transmission on its own
+    FrameScheduler scheduler(60.0);
     while(!glfwWindowShouldClose(mainWindow)){
+        double rate = 0.0;
+        PixelMapper::Patch::iterateActive(pixelMapper, [&](flecs::entity patch){
+            rate = std::max(rate, double(patch.get<PixelMapper::Patch::Settings>().refreshRate));
+        });
+        if(rate > 0.0) scheduler.setRate(rate);
+        scheduler.waitForNextFrame();
+
         //with multiple viewports the context of the main window needs to be set on each frame
 		glfwMakeContextCurrent(mainWindow);
         glfwPollEvents();
@@ -0,0 +1,62 @@
+#include "Bounds.h"
+
+#include <algorithm>
+
+#include "utils/Simd.h"
+
+namespace PixelMapper::Render{
+
+void findMinMax(const float* values, size_t count, float& min, float& max){
+    if(count == 0) return;
+    float lowest = values[0];
+    float highest = values[0];
+    size_t i = 0;
+#if defined(PIXELMAPPER_SSE2)
+    if(count >= 16){
+        //four independent accumulators per bound so the min/max latency overlaps
+        __m128 low[4], high[4];
+        for(int j = 0; j < 4; j++) low[j] = high[j] = _mm_loadu_ps(values + j * 4);
+        for(i = 16; i + 16 <= count; i += 16){
+            for(int j = 0; j < 4; j++){
+                __m128 v = _mm_loadu_ps(values + i + j * 4);
+                low[j] = _mm_min_ps(low[j], v);
+                high[j] = _mm_max_ps(high[j], v);
+            }
+        }
+        __m128 lowAll = _mm_min_ps(_mm_min_ps(low[0], low[1]), _mm_min_ps(low[2], low[3]));
+        __m128 highAll = _mm_max_ps(_mm_max_ps(high[0], high[1]), _mm_max_ps(high[2], high[3]));
+        float lows[4], highs[4];
+        _mm_storeu_ps(lows, lowAll);
+        _mm_storeu_ps(highs, highAll);
+        lowest = std::min(std::min(lows[0], lows[1]), std::min(lows[2], lows[3]));
+        highest = std::max(std::max(highs[0], highs[1]), std::max(highs[2], highs[3]));
+    }
+#elif defined(PIXELMAPPER_NEON)
+    if(count >= 16){
+        float32x4_t low[4], high[4];
+        for(int j = 0; j < 4; j++) low[j] = high[j] = vld1q_f32(values + j * 4);
+        for(i = 16; i + 16 <= count; i += 16){
+            for(int j = 0; j < 4; j++){
+                float32x4_t v = vld1q_f32(values + i + j * 4);
+                low[j] = vminq_f32(low[j], v);
+                high[j] = vmaxq_f32(high[j], v);
+            }
+        }
+        float32x4_t lowAll = vminq_f32(vminq_f32(low[0], low[1]), vminq_f32(low[2], low[3]));
+        float32x4_t highAll = vmaxq_f32(vmaxq_f32(high[0], high[1]), vmaxq_f32(high[2], high[3]));
+        float lows[4], highs[4];
+        vst1q_f32(lows, lowAll);
+        vst1q_f32(highs, highAll);
+        lowest = std::min(std::min(lows[0], lows[1]), std::min(lows[2], lows[3]));
+        highest = std::max(std::max(highs[0], highs[1]), std::max(highs[2], highs[3]));
+    }
+#endif
+    for(; i < count; i++){
+        lowest = std::min(lowest, values[i]);
+        highest = std::max(highest, values[i]);
+    }
+    min = lowest;
+    max = highest;
+}
+
+}//namespace PixelMapper::Render
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace PixelMapper::Render{
+
+    //smallest and largest of count values, min and max are left untouched when count is 0
+    void findMinMax(const float* values, size_t count, float& min, float& max);
+
+}//namespace PixelMapper::Render
@@ -0,0 +1,352 @@
+#include "EffectGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "utils/Simd.h"
+
+//the kernels are plain loops over planar float arrays without branches or calls per pixel, written so the compiler
+//vectorizes them (sse/neon) in optimized builds. std::sin doesn't vectorize, the ripple uses a polynomial instead
+//and std::sqrt is kept out of the loops by its errno check, it is done with intrinsics
+
+namespace PixelMapper::Render{
+
+const char* getEffectNodeTypeName(EffectNodeType type){
+    switch(type){
+        case EffectNodeType::Solid:         return "Solid";
+        case EffectNodeType::Gradient:      return "Gradient";
+        case EffectNodeType::Ripple:        return "Ripple";
+        case EffectNodeType::Brightness:    return "Brightness";
+        case EffectNodeType::Pulse:         return "Pulse";
+        case EffectNodeType::Invert:        return "Invert";
+        case EffectNodeType::Mix:           return "Mix";
+        case EffectNodeType::Add:           return "Add";
+        case EffectNodeType::Multiply:      return "Multiply";
+        case EffectNodeType::Lighten:       return "Lighten";
+        default:                            return "Unknown";
+    }
+}
+
+int getEffectNodeInputCount(EffectNodeType type){
+    switch(type){
+        case EffectNodeType::Solid:
+        case EffectNodeType::Gradient:
+        case EffectNodeType::Ripple:        return 0;
+        case EffectNodeType::Brightness:
+        case EffectNodeType::Pulse:
+        case EffectNodeType::Invert:        return 1;
+        default:                            return 2;
+    }
+}
+
+int EffectGraph::addNode(EffectNodeType type, int inputA, int inputB){
+    nodes.push_back(Node{type, {inputA, inputB}, {}});
+    b_dirty = true;
+    return int(nodes.size()) - 1;
+}
+
+void EffectGraph::connect(int node, int input, int source){
+    if(node < 0 || node >= int(nodes.size()) || input < 0 || input > 1) return;
+    nodes[node].inputs[input] = source;
+    b_dirty = true;
+}
+
+void EffectGraph::clear(){
+    nodes.clear();
+    schedule.clear();
+    output = -1;
+    layerCount = 0;
+    b_dirty = true;
+}
+
+bool EffectGraph::compile(){
+    b_dirty = false;
+    schedule.clear();
+    layerCount = 0;
+    if(output < 0 || output >= int(nodes.size())) return false;
+
+    //depth first from the output, post order is a valid execution order
+    enum : uint8_t { Unvisited, Visiting, Done };
+    std::vector<uint8_t> state(nodes.size(), Unvisited);
+    std::vector<int> order;
+    bool b_valid = true;
+    auto visit = [&](auto& self, int node) -> void{
+        if(state[node] == Done) return;
+        if(state[node] == Visiting){
+            std::cout << "Effect graph has a cycle at node " << node << std::endl;
+            b_valid = false;
+            return;
+        }
+        state[node] = Visiting;
+        for(int i = 0; i < getEffectNodeInputCount(nodes[node].type); i++){
+            int input = nodes[node].inputs[i];
+            if(input < 0 || input >= int(nodes.size())){
+                std::cout << "Effect graph node " << node << " has no input " << i << std::endl;
+                b_valid = false;
+                continue;
+            }
+            self(self, input);
+        }
+        state[node] = Done;
+        order.push_back(node);
+    };
+    visit(visit, output);
+    if(!b_valid) return false;
+
+    //readers left per node, a layer is free again after the last one
+    std::vector<int> readers(nodes.size(), 0);
+    for(int node : order){
+        for(int i = 0; i < getEffectNodeInputCount(nodes[node].type); i++) readers[nodes[node].inputs[i]]++;
+    }
+    std::vector<uint16_t> layerOf(nodes.size(), 0);
+    std::vector<uint16_t> freeLayers;
+    for(int node : order){
+        Step step{nodes[node].type, node, 0, {0, 0}};
+        //the output layer is taken before the inputs are released, kernels never read and write the same layer
+        if(!freeLayers.empty()){
+            step.output = freeLayers.back();
+            freeLayers.pop_back();
+        }
+        else step.output = uint16_t(layerCount++);
+        for(int i = 0; i < getEffectNodeInputCount(step.type); i++){
+            int input = nodes[node].inputs[i];
+            step.inputs[i] = layerOf[input];
+            if(--readers[input] == 0) freeLayers.push_back(layerOf[input]);
+        }
+        layerOf[node] = step.output;
+        schedule.push_back(step);
+    }
+    outputLayer = layerOf[output];
+    return true;
+}
+
+namespace{
+
+    struct Layer{
+        float* r;
+        float* g;
+        float* b;
+    };
+
+    //t wrapped to [-0.5, 0.5], truncating conversions only so the loops stay branch free
+    inline float wrapTurns(float t){
+        t -= float(int32_t(t));         //(-1, 1)
+        return t - float(int32_t(t + t));
+    }
+
+    //sin(2 pi t) for any t, parabola with one refinement step, error below 0.001
+    inline float sinTurns(float t){
+        t = wrapTurns(t);
+        float y = 8.0f * t - 16.0f * t * std::fabs(t);
+        return 0.225f * (y * std::fabs(y) - y) + y;
+    }
+
+    void sqrtInPlace(float* values, size_t count){
+        size_t i = 0;
+#if defined(PIXELMAPPER_SSE2)
+        for(; i + 4 <= count; i += 4) _mm_storeu_ps(values + i, _mm_sqrt_ps(_mm_loadu_ps(values + i)));
+#elif defined(PIXELMAPPER_NEON) && defined(__aarch64__)
+        for(; i + 4 <= count; i += 4) vst1q_f32(values + i, vsqrtq_f32(vld1q_f32(values + i)));
+#endif
+        for(; i < count; i++) values[i] = std::sqrt(values[i]);
+    }
+
+    void fillMix(Layer out, const float* t, glm::vec3 a, glm::vec3 b, size_t count){
+        glm::vec3 d = b - a;
+        for(size_t i = 0; i < count; i++){
+            out.r[i] = a.x + d.x * t[i];
+            out.g[i] = a.y + d.y * t[i];
+            out.b[i] = a.z + d.z * t[i];
+        }
+    }
+
+    void solid(Layer out, const EffectParameters& p, size_t count){
+        std::fill_n(out.r, count, p.colorA.x);
+        std::fill_n(out.g, count, p.colorA.y);
+        std::fill_n(out.b, count, p.colorA.z);
+    }
+
+    //whole turns removed in double precision, keeps the phase exact however long the show runs
+    inline float getTimeOffset(float time, float speed, float unitsPerTurn){
+        double turns = double(time) * double(speed) / double(unitsPerTurn);
+        return float(-(turns - std::floor(turns)));
+    }
+
+    //t goes 0..1..0 once per scale units
+    void gradient(Layer out, float* t, const float* x, const float* y, glm::vec3 center, float time, const EffectParameters& p, size_t count){
+        float scale = std::max(std::fabs(p.scale), 0.001f);
+        float dirX = p.direction.x / scale;
+        float dirY = p.direction.y / scale;
+        float offset = -(center.x * dirX + center.y * dirY) + getTimeOffset(time, p.speed, scale);
+        for(size_t i = 0; i < count; i++){
+            float phase = wrapTurns(x[i] * dirX + y[i] * dirY + offset);
+            t[i] = 1.0f - 2.0f * std::fabs(phase);
+        }
+        fillMix(out, t, p.colorB, p.colorA, count);
+    }
+
+    void ripple(Layer out, float* t, const float* x, const float* y, const float* z, glm::vec3 center, float time, const EffectParameters& p, size_t count){
+        float unitsPerTurn = std::max(std::fabs(p.scale), 0.001f) * 6.2831853f;
+        float turnsPerUnit = 1.0f / unitsPerTurn;
+        float offset = getTimeOffset(time, p.speed, unitsPerTurn);
+        for(size_t i = 0; i < count; i++){
+            float dx = x[i] - center.x;
+            float dy = y[i] - center.y;
+            float dz = z[i] - center.z;
+            t[i] = dx * dx + dy * dy + dz * dz;
+        }
+        sqrtInPlace(t, count);
+        for(size_t i = 0; i < count; i++) t[i] = std::max(sinTurns(t[i] * turnsPerUnit + offset), 0.0f);
+        fillMix(out, t, p.colorB, p.colorA, count);
+    }
+
+    void multiply(Layer out, Layer in, float factor, size_t count){
+        for(size_t i = 0; i < count; i++){
+            out.r[i] = in.r[i] * factor;
+            out.g[i] = in.g[i] * factor;
+            out.b[i] = in.b[i] * factor;
+        }
+    }
+
+    void invert(Layer out, Layer in, float amount, size_t count){
+        for(size_t i = 0; i < count; i++){
+            out.r[i] = in.r[i] + (1.0f - 2.0f * in.r[i]) * amount;
+            out.g[i] = in.g[i] + (1.0f - 2.0f * in.g[i]) * amount;
+            out.b[i] = in.b[i] + (1.0f - 2.0f * in.b[i]) * amount;
+        }
+    }
+
+    //out = a + (f(a, b) - a) * amount, per channel
+    template<typename BlendFn>
+    void blend(Layer out, Layer a, Layer b, float amount, size_t count, BlendFn&& fn){
+        const float* ina[3] = {a.r, a.g, a.b};
+        const float* inb[3] = {b.r, b.g, b.b};
+        float* outc[3] = {out.r, out.g, out.b};
+        for(int c = 0; c < 3; c++){
+            const float* pa = ina[c];
+            const float* pb = inb[c];
+            float* po = outc[c];
+            for(size_t i = 0; i < count; i++) po[i] = pa[i] + (fn(pa[i], pb[i]) - pa[i]) * amount;
+        }
+    }
+
+    //the white channel takes the common part of rgb
+    void writeColors(ColorRGBW* colors, Layer in, size_t count){
+        static_assert(sizeof(ColorRGBW) == 4);
+        size_t i = 0;
+#if defined(PIXELMAPPER_SSE2)
+        //four pixels at once, the channels are shifted into place and stored as one rgbw word per pixel
+        __m128 zero = _mm_setzero_ps();
+        __m128 full = _mm_set1_ps(255.0f);
+        __m128 half = _mm_set1_ps(0.5f);
+        for(; i + 4 <= count; i += 4){
+            __m128 r = _mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in.r + i), full), zero), full), half);
+            __m128 g = _mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in.g + i), full), zero), full), half);
+            __m128 b = _mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in.b + i), full), zero), full), half);
+            __m128 w = _mm_min_ps(r, _mm_min_ps(g, b));
+            __m128i packed = _mm_or_si128(
+                _mm_or_si128(_mm_cvttps_epi32(r), _mm_slli_epi32(_mm_cvttps_epi32(g), 8)),
+                _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(b), 16), _mm_slli_epi32(_mm_cvttps_epi32(w), 24)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(colors + i), packed);
+        }
+#elif defined(PIXELMAPPER_NEON)
+        float32x4_t zero = vdupq_n_f32(0.0f);
+        float32x4_t full = vdupq_n_f32(255.0f);
+        float32x4_t half = vdupq_n_f32(0.5f);
+        for(; i + 4 <= count; i += 4){
+            float32x4_t r = vaddq_f32(vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(in.r + i), full), zero), full), half);
+            float32x4_t g = vaddq_f32(vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(in.g + i), full), zero), full), half);
+            float32x4_t b = vaddq_f32(vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(in.b + i), full), zero), full), half);
+            float32x4_t w = vminq_f32(r, vminq_f32(g, b));
+            uint32x4_t packed = vorrq_u32(
+                vorrq_u32(vcvtq_u32_f32(r), vshlq_n_u32(vcvtq_u32_f32(g), 8)),
+                vorrq_u32(vshlq_n_u32(vcvtq_u32_f32(b), 16), vshlq_n_u32(vcvtq_u32_f32(w), 24)));
+            vst1q_u32(reinterpret_cast<uint32_t*>(colors + i), packed);
+        }
+#endif
+        for(; i < count; i++){
+            float r = std::min(std::max(in.r[i] * 255.0f, 0.0f), 255.0f) + 0.5f;
+            float g = std::min(std::max(in.g[i] * 255.0f, 0.0f), 255.0f) + 0.5f;
+            float b = std::min(std::max(in.b[i] * 255.0f, 0.0f), 255.0f) + 0.5f;
+            colors[i] = ColorRGBW{uint8_t(r), uint8_t(g), uint8_t(b), uint8_t(std::min(r, std::min(g, b)))};
+        }
+    }
+
+}//namespace
+
+void EffectGraph::render(Patch::PixelStore& store, glm::vec3 center, float time, size_t begin, size_t end) const{
+    if(schedule.empty()) return;
+    end = std::min(end, store.colors.size());
+    //per thread scratch, the layers plus one array for the generators, grows to the largest schedule once
+    thread_local std::vector<float> scratch;
+    size_t layerSize = ChunkSize * 3;
+    if(scratch.size() < layerCount * layerSize + ChunkSize) scratch.resize(layerCount * layerSize + ChunkSize);
+    float* generatorScratch = scratch.data() + layerCount * layerSize;
+    auto getLayer = [&](uint16_t layer){
+        float* base = scratch.data() + layer * layerSize;
+        return Layer{base, base + ChunkSize, base + ChunkSize * 2};
+    };
+
+    for(size_t first = begin; first < end; first += ChunkSize){
+        size_t count = std::min(ChunkSize, end - first);
+        const float* x = store.x.data() + first;
+        const float* y = store.y.data() + first;
+        const float* z = store.z.data() + first;
+        for(const Step& step : schedule){
+            const EffectParameters& p = nodes[step.node].parameters;
+            Layer out = getLayer(step.output);
+            Layer a = getLayer(step.inputs[0]);
+            Layer b = getLayer(step.inputs[1]);
+            switch(step.type){
+                case EffectNodeType::Solid:         solid(out, p, count); break;
+                case EffectNodeType::Gradient:      gradient(out, generatorScratch, x, y, center, time, p, count); break;
+                case EffectNodeType::Ripple:        ripple(out, generatorScratch, x, y, z, center, time, p, count); break;
+                case EffectNodeType::Brightness:    multiply(out, a, p.amount, count); break;
+                case EffectNodeType::Pulse:
+                    multiply(out, a, 1.0f - p.amount * (0.5f - 0.5f * std::sin(time * p.speed * 6.2831853f)), count);
+                    break;
+                case EffectNodeType::Invert:        invert(out, a, p.amount, count); break;
+                case EffectNodeType::Mix:           blend(out, a, b, p.amount, count, [](float, float vb){ return vb; }); break;
+                case EffectNodeType::Add:           blend(out, a, b, p.amount, count, [](float va, float vb){ return va + vb; }); break;
+                case EffectNodeType::Multiply:      blend(out, a, b, p.amount, count, [](float va, float vb){ return va * vb; }); break;
+                case EffectNodeType::Lighten:       blend(out, a, b, p.amount, count, [](float va, float vb){ return std::max(va, vb); }); break;
+                default: break;
+            }
+        }
+        writeColors(store.colors.data() + first, getLayer(outputLayer), count);
+    }
+}
+
+EffectGraph createRippleEffect(){
+    EffectGraph graph;
+    int ripple = graph.addNode(EffectNodeType::Ripple);
+    graph.getParameters(ripple).scale = 30.0f;
+    graph.getParameters(ripple).speed = 100.0f;
+    graph.setOutput(ripple);
+    return graph;
+}
+
+EffectGraph createLayeredEffect(){
+    EffectGraph graph;
+    int gradient = graph.addNode(EffectNodeType::Gradient);
+    auto& gradientParameters = graph.getParameters(gradient);
+    gradientParameters.colorA = glm::vec3(1.0f, 0.1f, 0.0f);
+    gradientParameters.colorB = glm::vec3(0.0f, 0.2f, 1.0f);
+    gradientParameters.direction = glm::vec2(0.7f, 0.7f);
+    gradientParameters.scale = 400.0f;
+    gradientParameters.speed = 50.0f;
+    int ripple = graph.addNode(EffectNodeType::Ripple);
+    graph.getParameters(ripple).scale = 30.0f;
+    graph.getParameters(ripple).speed = 100.0f;
+    int dimmedRipple = graph.addNode(EffectNodeType::Brightness, ripple);
+    graph.getParameters(dimmedRipple).amount = 0.6f;
+    int layered = graph.addNode(EffectNodeType::Lighten, gradient, dimmedRipple);
+    int pulse = graph.addNode(EffectNodeType::Pulse, layered);
+    graph.getParameters(pulse).speed = 0.5f;
+    graph.getParameters(pulse).amount = 0.3f;
+    graph.setOutput(pulse);
+    return graph;
+}
+
+}//namespace PixelMapper::Render
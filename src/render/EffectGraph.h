@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "PixelMapper.h"
+
+namespace PixelMapper::Render{
+
+    enum class EffectNodeType : uint8_t{
+        //generators, no inputs
+        Solid,      //colorA everywhere
+        Gradient,   //colorA to colorB and back along direction, one period every scale units, moving at speed units/s
+        Ripple,     //rings of colorA on colorB around the render area center, scale units per radian, moving out at speed units/s
+        //modifiers, one input
+        Brightness, //input * amount
+        Pulse,      //input dimmed by a sine of speed hz, amount is the depth
+        Invert,     //1 - input, amount mixes it with the input
+        //blends, two inputs, amount is the opacity of the second input
+        Mix,
+        Add,
+        Multiply,
+        Lighten,
+        Count
+    };
+    const char* getEffectNodeTypeName(EffectNodeType type);
+    int getEffectNodeInputCount(EffectNodeType type);
+
+    //every node type reads the fields it needs, see EffectNodeType, colors are linear 0..1
+    struct EffectParameters{
+        glm::vec3 colorA = glm::vec3(1.0f);
+        glm::vec3 colorB = glm::vec3(0.0f);
+        glm::vec2 direction = glm::vec2(1.0f, 0.0f);
+        float scale = 100.0f;
+        float speed = 0.0f;
+        float amount = 1.0f;
+    };
+
+    //graph of generator, modifier and blend nodes that renders the colors of a patch
+    //compile() orders the nodes reachable from the output into a linear schedule and gives every node result a scratch
+    //layer (planar float rgb), a layer is reused once its last reader ran. Each step of the schedule is one kernel running
+    //a tight loop over a whole chunk of pixels, there is no per pixel dispatch. Parameters are read while rendering, so
+    //changing them needs no recompile, only adding or reconnecting nodes does
+    class EffectGraph{
+    public:
+
+        static constexpr size_t ChunkSize = 4096;   //pixels per kernel call, sizes the per thread scratch layers
+
+        //returns the node index, inputs are node indices or -1
+        int addNode(EffectNodeType type, int inputA = -1, int inputB = -1);
+        void connect(int node, int input, int source);
+        void setOutput(int node){ output = node; b_dirty = true; }
+        void clear();
+
+        int getNodeCount() const { return int(nodes.size()); }
+        int getOutput() const { return output; }
+        EffectNodeType getNodeType(int node) const { return nodes[node].type; }
+        int getNodeInput(int node, int input) const { return nodes[node].inputs[input]; }
+        EffectParameters& getParameters(int node){ return nodes[node].parameters; }
+
+        //ecs thread, before rendering, only needed after the structure changed
+        //returns false when the output is missing, an input is unconnected or the graph has a cycle, nothing is rendered then
+        bool needsCompile() const { return b_dirty; }
+        bool compile();
+
+        //any thread, renders the colors of pixels [begin, end), center is the render area center, time in seconds
+        void render(Patch::PixelStore& store, glm::vec3 center, float time, size_t begin, size_t end) const;
+
+    private:
+
+        struct Node{
+            EffectNodeType type;
+            int inputs[2];
+            EffectParameters parameters;
+        };
+
+        struct Step{
+            EffectNodeType type;
+            int node;
+            uint16_t output;
+            uint16_t inputs[2];
+        };
+
+        std::vector<Node> nodes;
+        int output = -1;
+        std::vector<Step> schedule;
+        uint16_t outputLayer = 0;
+        size_t layerCount = 0;
+        bool b_dirty = true;
+    };
+
+    //white rings moving out from the center
+    EffectGraph createRippleEffect();
+    //moving color gradient, lightened by the ripple and pulsing, exercises every node kind
+    EffectGraph createLayeredEffect();
+
+}//namespace PixelMapper::Render
@@ -0,0 +1,92 @@
+#include "FrameSource.h"
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+
+namespace PixelMapper::Render{
+
+RawFileSource::RawFileSource(const char* path, int width_, int height_) : width(width_), height(height_) {
+    if(width <= 0 || height <= 0) return;
+    if(!file.open(path)) return;
+    frameCount = file.size() / (size_t(width) * size_t(height) * 4);
+}
+
+bool RawFileSource::nextFrame(Frame& frame){
+    if(frameCount == 0) return false;
+    size_t frameSize = size_t(width) * size_t(height) * 4;
+    frame.width = width;
+    frame.height = height;
+    frame.rgba = file.data() + currentFrame * frameSize;
+    currentFrame = (currentFrame + 1) % frameCount;
+    return true;
+}
+
+
+namespace{
+
+    //reads the next header token of a ppm, skipping whitespace and comments
+    bool readPpmToken(std::istream& in, int& value){
+        int c = in.peek();
+        while(c != EOF){
+            if(c == '#') while(c != EOF && c != '\n') { in.get(); c = in.peek(); }
+            else if(std::isspace(c)) { in.get(); c = in.peek(); }
+            else break;
+        }
+        return bool(in >> value);
+    }
+
+    bool loadPpm(const std::string& path, int& width, int& height, std::vector<uint8_t>& rgba){
+        std::ifstream in(path, std::ios::binary);
+        char magic[2];
+        if(!in.read(magic, 2) || magic[0] != 'P' || magic[1] != '6') return false;
+        int maxValue;
+        if(!readPpmToken(in, width) || !readPpmToken(in, height) || !readPpmToken(in, maxValue)) return false;
+        if(width <= 0 || height <= 0 || maxValue != 255) return false;
+        in.get(); //single whitespace before the pixel data
+        size_t pixelCount = size_t(width) * size_t(height);
+        std::vector<uint8_t> rgb(pixelCount * 3);
+        if(!in.read(reinterpret_cast<char*>(rgb.data()), std::streamsize(rgb.size()))) return false;
+        rgba.resize(pixelCount * 4);
+        for(size_t i = 0; i < pixelCount; i++){
+            rgba[i * 4 + 0] = rgb[i * 3 + 0];
+            rgba[i * 4 + 1] = rgb[i * 3 + 1];
+            rgba[i * 4 + 2] = rgb[i * 3 + 2];
+            rgba[i * 4 + 3] = 255;
+        }
+        return true;
+    }
+
+}//namespace
+
+
+ImageSequenceSource::ImageSequenceSource(const std::vector<std::string>& paths){
+    for(const auto& path : paths){
+        int imageWidth, imageHeight;
+        std::vector<uint8_t> rgba;
+        if(!loadPpm(path, imageWidth, imageHeight, rgba)){
+            std::cout << "Could not load image " << path << std::endl;
+            continue;
+        }
+        if(frames.empty()){
+            width = imageWidth;
+            height = imageHeight;
+        }
+        else if(imageWidth != width || imageHeight != height){
+            std::cout << "Image " << path << " does not match the sequence size" << std::endl;
+            continue;
+        }
+        frames.push_back(std::move(rgba));
+    }
+}
+
+bool ImageSequenceSource::nextFrame(Frame& frame){
+    if(frames.empty()) return false;
+    frame.width = width;
+    frame.height = height;
+    frame.rgba = frames[currentFrame].data();
+    currentFrame = (currentFrame + 1) % frames.size();
+    return true;
+}
+
+}//namespace PixelMapper::Render
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "utils/MappedFile.h"
+
+namespace PixelMapper::Render{
+
+    //one frame of 8 bit rgba content, rows top to bottom, tightly packed
+    //the pixels stay owned by the source and are valid until its next call to nextFrame()
+    struct Frame{
+        int width = 0;
+        int height = 0;
+        const uint8_t* rgba = nullptr;
+    };
+
+    //produces content frames for a patch, polled once per render frame
+    class FrameSource{
+    public:
+        virtual ~FrameSource() = default;
+        //returns false when no frame is available, the patch then keeps its previous colors
+        virtual bool nextFrame(Frame& frame) = 0;
+        //called once the frame from nextFrame() was read, false when the source overwrote it in the meantime,
+        //whatever was read from it is torn and has to be discarded
+        virtual bool finishFrame(){ return true; }
+        //steady clock nanoseconds at which the producer published the last finished frame, 0 when unknown
+        virtual int64_t getPublishTime() const { return 0; }
+    };
+
+    //file of back to back raw rgba frames of a known size, mapped and played in a loop
+    class RawFileSource : public FrameSource{
+    public:
+        RawFileSource(const char* path, int width, int height);
+        bool isOpen() const { return frameCount > 0; }
+        bool nextFrame(Frame& frame) override;
+    private:
+        MappedFile file;
+        int width;
+        int height;
+        size_t frameCount = 0;
+        size_t currentFrame = 0;
+    };
+
+    //sequence of binary ppm (P6) images, all decoded to rgba on load and played in a loop
+    class ImageSequenceSource : public FrameSource{
+    public:
+        explicit ImageSequenceSource(const std::vector<std::string>& paths);
+        bool isOpen() const { return !frames.empty(); }
+        bool nextFrame(Frame& frame) override;
+    private:
+        int width = 0;
+        int height = 0;
+        std::vector<std::vector<uint8_t>> frames;
+        size_t currentFrame = 0;
+    };
+
+}//namespace PixelMapper::Render
@@ -0,0 +1,71 @@
+#include "Sampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace PixelMapper::Render{
+
+void resizeSampleMap(Patch::SampleMap& map, size_t pixelCount, int width, int height){
+    map.width = width;
+    map.height = height;
+    map.strideX = width > 1 ? 1 : 0;
+    map.strideY = height > 1 ? uint32_t(width) : 0;
+    map.index.resize(pixelCount);
+    map.fx.resize(pixelCount);
+    map.fy.resize(pixelCount);
+}
+
+void buildSamples(Patch::SampleMap& map, const Patch::PixelStore& store, const Patch::RenderArea& area, size_t begin, size_t end){
+    const int width = map.width;
+    const int height = map.height;
+
+    //a flat render area (single pixel or a straight line) samples the middle of the frame on that axis
+    glm::vec2 extent(area.max.x - area.min.x, area.max.y - area.min.y);
+    float scaleX = extent.x > 0.0f ? float(width - 1) / extent.x : 0.0f;
+    float scaleY = extent.y > 0.0f ? float(height - 1) / extent.y : 0.0f;
+    float centerX = float(width - 1) * 0.5f;
+    float centerY = float(height - 1) * 0.5f;
+    int maxX = std::max(width - 2, 0);
+    int maxY = std::max(height - 2, 0);
+
+    for(size_t i = begin; i < end; i++){
+        float tx = extent.x > 0.0f ? (store.x[i] - area.min.x) * scaleX : centerX;
+        float ty = extent.y > 0.0f ? (store.y[i] - area.min.y) * scaleY : centerY;
+        int x = std::clamp(int(std::floor(tx)), 0, maxX);
+        int y = std::clamp(int(std::floor(ty)), 0, maxY);
+        map.index[i] = uint32_t(y) * uint32_t(width) + uint32_t(x);
+        map.fx[i] = map.strideX ? std::clamp(tx - float(x), 0.0f, 1.0f) : 0.0f;
+        map.fy[i] = map.strideY ? std::clamp(ty - float(y), 0.0f, 1.0f) : 0.0f;
+    }
+}
+
+void sampleFrame(const Patch::SampleMap& map, const Frame& frame, ColorRGBW* colors, size_t begin, size_t end){
+    const uint8_t* texels = frame.rgba;
+    const uint32_t right = map.strideX * 4;
+    const uint32_t down = map.strideY * 4;
+    const uint32_t* index = map.index.data();
+    const float* fx = map.fx.data();
+    const float* fy = map.fy.data();
+    for(size_t i = begin; i < end; i++){
+        const uint8_t* t00 = texels + size_t(index[i]) * 4;
+        const uint8_t* t10 = t00 + right;
+        const uint8_t* t01 = t00 + down;
+        const uint8_t* t11 = t01 + right;
+        float w00 = (1.0f - fx[i]) * (1.0f - fy[i]);
+        float w10 = fx[i] * (1.0f - fy[i]);
+        float w01 = (1.0f - fx[i]) * fy[i];
+        float w11 = fx[i] * fy[i];
+        auto blend = [&](int c) -> uint8_t {
+            return uint8_t(t00[c] * w00 + t10[c] * w10 + t01[c] * w01 + t11[c] * w11 + 0.5f);
+        };
+        //video has no white channel, rgbw fixtures only get the rgb part
+        colors[i] = ColorRGBW{
+            .r = blend(0),
+            .g = blend(1),
+            .b = blend(2),
+            .w = 0
+        };
+    }
+}
+
+}//namespace PixelMapper::Render
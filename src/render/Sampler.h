@@ -0,0 +1,17 @@
+#pragma once
+
+#include "PixelMapper.h"
+#include "FrameSource.h"
+
+namespace PixelMapper::Render{
+
+    //sets the frame size the map samples from and allocates one sample per pixel, samples need to be rebuilt after this
+    void resizeSampleMap(Patch::SampleMap& map, size_t pixelCount, int width, int height);
+
+    //maps the patch render area onto the whole frame and precomputes the texel index and bilinear weights of pixels [begin, end)
+    void buildSamples(Patch::SampleMap& map, const Patch::PixelStore& store, const Patch::RenderArea& area, size_t begin, size_t end);
+
+    //gathers the colors of pixels [begin, end) from a frame matching the map size
+    void sampleFrame(const Patch::SampleMap& map, const Frame& frame, ColorRGBW* colors, size_t begin, size_t end);
+
+}//namespace PixelMapper::Render
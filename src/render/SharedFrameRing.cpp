@@ -0,0 +1,127 @@
+#include "SharedFrameRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+
+namespace PixelMapper::Render{
+
+using namespace SharedFrameRing;
+
+static int64_t getTimestamp(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static SlotHeader* getSlot(uint8_t* base, const Header* header, uint64_t frame){
+    return reinterpret_cast<SlotHeader*>(base + sizeof(Header) + (frame % header->slotCount) * header->slotStride);
+}
+
+
+bool SharedFrameProducer::create(const char* name, uint32_t width, uint32_t height, uint32_t slotCount){
+    if(width == 0 || height == 0 || slotCount < MinSlotCount) return false;
+    if(!memory.create(name, getSize(width, height, slotCount))) return false;
+    header = new(memory.data()) Header{};
+    header->magic = Magic;
+    header->version = Version;
+    header->width = width;
+    header->height = height;
+    header->format = PixelFormat::RGBA8;
+    header->slotCount = slotCount;
+    header->slotStride = getSlotStride(width, height);
+    for(uint32_t i = 0; i < slotCount; i++) new(getSlot(memory.data(), header, i)) SlotHeader{};
+    header->published.store(0, std::memory_order_release);
+    frame = 0;
+    return true;
+}
+
+uint8_t* SharedFrameProducer::beginFrame(){
+    if(!header) return nullptr;
+    currentSlot = getSlot(memory.data(), header, frame);
+    currentSlot->sequence.store(frame * 2 + 1, std::memory_order_relaxed);
+    //the odd sequence has to be visible before any pixel changes
+    std::atomic_thread_fence(std::memory_order_release);
+    return reinterpret_cast<uint8_t*>(currentSlot) + sizeof(SlotHeader);
+}
+
+void SharedFrameProducer::publishFrame(){
+    if(!currentSlot) return;
+    currentSlot->publishTime = getTimestamp();
+    currentSlot->sequence.store(frame * 2 + 2, std::memory_order_release);
+    header->published.store(frame + 1, std::memory_order_release);
+    currentSlot = nullptr;
+    frame++;
+}
+
+
+bool SharedMemorySource::connect(){
+    if(!memory.open(name.c_str())) return false;
+    auto* candidate = reinterpret_cast<const Header*>(memory.data());
+    bool valid = memory.size() >= sizeof(Header)
+        && candidate->magic == Magic
+        && candidate->version == Version
+        && candidate->format == PixelFormat::RGBA8
+        && candidate->slotCount >= MinSlotCount
+        && candidate->slotStride == getSlotStride(candidate->width, candidate->height)
+        && memory.size() >= getSize(candidate->width, candidate->height, candidate->slotCount);
+    if(!valid){
+        memory.close();
+        return false;
+    }
+    header = candidate;
+    lastPublished = 0;
+    return true;
+}
+
+bool SharedMemorySource::nextFrame(Frame& frame){
+    if(!header && !connect()) return false;
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    if(published == 0 || published == lastPublished) return false;
+    uint64_t newest = published - 1;
+    const SlotHeader* slot = getSlot(memory.data(), header, newest);
+    //the producer already started overwriting this slot, we are more than a whole ring behind
+    if(slot->sequence.load(std::memory_order_acquire) != newest * 2 + 2) return false;
+    lastPublished = published;
+    readingSlot = slot;
+    readingSequence = newest * 2 + 2;
+
+    frame.width = int(header->width);
+    frame.height = int(header->height);
+    frame.rgba = reinterpret_cast<const uint8_t*>(slot) + sizeof(SlotHeader);
+    return true;
+}
+
+bool SharedMemorySource::finishFrame(){
+    if(!readingSlot) return false;
+    const SlotHeader* slot = readingSlot;
+    readingSlot = nullptr;
+    int64_t slotPublishTime = slot->publishTime;
+    //the pixel reads have to be done before the sequence is looked at again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(slot->sequence.load(std::memory_order_relaxed) != readingSequence){
+        tornCount++;
+        return false;
+    }
+    publishTime = slotPublishTime;
+    double latency = double(getTimestamp() - publishTime) / 1e6;
+    latencySum += latency;
+    latencyMax = std::max(latencyMax, latency);
+    latencyCount++;
+    return true;
+}
+
+SharedMemorySource::LatencyStatistics SharedMemorySource::getLatencyStatistics(){
+    LatencyStatistics statistics;
+    statistics.frameCount = latencyCount;
+    statistics.tornCount = tornCount;
+    if(latencyCount > 0){
+        statistics.average = latencySum / double(latencyCount);
+        statistics.max = latencyMax;
+    }
+    latencySum = 0.0;
+    latencyMax = 0.0;
+    latencyCount = 0;
+    tornCount = 0;
+    return statistics;
+}
+
+}//namespace PixelMapper::Render
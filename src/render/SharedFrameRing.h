@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "FrameSource.h"
+#include "utils/SharedMemory.h"
+
+namespace PixelMapper::Render{
+
+    //Frame ring in named shared memory, for content produced by another process (media server)
+    //[Header][Slot 0][Slot 1]...[Slot n-1], each slot is a SlotHeader followed by width * height rgba pixels
+    //single producer, any number of readers, nobody ever waits:
+    //the producer writes frame f into slot f % slotCount (seqlock style: odd sequence while writing, even when done)
+    //and then publishes it, readers always take the newest published frame and read it in place.
+    //at least 3 slots, so the producer has to lap the whole ring before it touches a frame that is still being read,
+    //readers check the slot sequence again after reading (finishFrame) and drop the frame if that happened anyway
+    namespace SharedFrameRing{
+        constexpr uint32_t Magic = 0x52465850; //"PXFR"
+        constexpr uint32_t Version = 1;
+        constexpr uint32_t MinSlotCount = 3;
+
+        enum class PixelFormat : uint32_t{
+            RGBA8 = 0
+        };
+
+        struct alignas(64) Header{
+            uint32_t magic;
+            uint32_t version;
+            uint32_t width;
+            uint32_t height;
+            PixelFormat format;
+            uint32_t slotCount;
+            uint64_t slotStride;                //bytes from one slot to the next
+            alignas(64) std::atomic<uint64_t> published; //number of published frames, the newest one is published - 1
+        };
+        struct alignas(64) SlotHeader{
+            std::atomic<uint64_t> sequence;     //2 * frame + 1 while writing, 2 * frame + 2 once complete
+            int64_t publishTime;                //steady clock nanoseconds, the clock is shared between processes
+        };
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory atomics need to be lock free");
+
+        constexpr uint64_t getSlotStride(uint32_t width, uint32_t height){
+            uint64_t size = sizeof(SlotHeader) + uint64_t(width) * uint64_t(height) * 4;
+            return (size + 63) & ~uint64_t(63);
+        }
+        constexpr uint64_t getSize(uint32_t width, uint32_t height, uint32_t slotCount){
+            return sizeof(Header) + getSlotStride(width, height) * slotCount;
+        }
+    };
+
+    //writing side, also used by the headless test producer
+    class SharedFrameProducer{
+    public:
+        bool create(const char* name, uint32_t width, uint32_t height, uint32_t slotCount = 3);
+        //pixels of the next frame, write width * height rgba pixels then publish
+        uint8_t* beginFrame();
+        void publishFrame();
+    private:
+        SharedMemory memory;
+        SharedFrameRing::Header* header = nullptr;
+        SharedFrameRing::SlotHeader* currentSlot = nullptr;
+        uint64_t frame = 0;
+    };
+
+    //reading side, frames point straight into the shared slots
+    class SharedMemorySource : public FrameSource{
+    public:
+        //time from publishing a frame to the render stage picking it up, in milliseconds
+        struct LatencyStatistics{
+            double average = 0.0;
+            double max = 0.0;
+            uint64_t frameCount = 0;
+            uint64_t tornCount = 0;     //frames overwritten while they were read, dropped
+        };
+
+        explicit SharedMemorySource(const char* name) : name(name) {}
+        //connects lazily, the producer may start after us
+        bool nextFrame(Frame& frame) override;
+        bool finishFrame() override;
+        int64_t getPublishTime() const override { return publishTime; }
+        //statistics since the last call
+        LatencyStatistics getLatencyStatistics();
+    private:
+        bool connect();
+        std::string name;
+        SharedMemory memory;
+        const SharedFrameRing::Header* header = nullptr;
+        uint64_t lastPublished = 0;
+        const SharedFrameRing::SlotHeader* readingSlot = nullptr;
+        uint64_t readingSequence = 0;
+        int64_t publishTime = 0;
+        double latencySum = 0.0;
+        double latencyMax = 0.0;
+        uint64_t latencyCount = 0;
+        uint64_t tornCount = 0;
+    };
+
+}//namespace PixelMapper::Render
@@ -0,0 +1,113 @@
+#include "SpatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace PixelMapper::Render{
+
+static int32_t getCellCoordinate(float value, float cellSize){
+    return int32_t(std::floor(value / cellSize));
+}
+
+static uint64_t getCellKey(int32_t x, int32_t y){
+    return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+}
+
+static uint64_t getPixelKey(const Patch::SpatialIndex& index, const Patch::PixelStore& store, uint32_t pixel){
+    return getCellKey(getCellCoordinate(store.x[pixel], index.cellSize), getCellCoordinate(store.y[pixel], index.cellSize));
+}
+
+static void insertPixel(Patch::SpatialIndex& index, uint32_t pixel, uint64_t key){
+    auto& cell = index.cells[key];
+    index.pixelCell[pixel] = key;
+    index.pixelSlot[pixel] = uint32_t(cell.size());
+    cell.push_back(pixel);
+}
+
+//swap remove, the last pixel of the cell takes the free slot
+static void removePixel(Patch::SpatialIndex& index, uint32_t pixel){
+    auto it = index.cells.find(index.pixelCell[pixel]);
+    if(it == index.cells.end()) return;
+    auto& cell = it->second;
+    uint32_t slot = index.pixelSlot[pixel];
+    uint32_t last = cell.back();
+    cell[slot] = last;
+    index.pixelSlot[last] = slot;
+    cell.pop_back();
+    if(cell.empty()) index.cells.erase(it);
+}
+
+//calls fn(cell pixels) for every cell overlapping [min, max]
+//a rectangle covering more cells than exist (zoomed out views) walks the occupied cells instead
+template<typename Fn>
+static void forEachCell(const Patch::SpatialIndex& index, glm::vec2 min, glm::vec2 max, Fn&& fn){
+    int32_t minX = getCellCoordinate(min.x, index.cellSize);
+    int32_t minY = getCellCoordinate(min.y, index.cellSize);
+    int32_t maxX = getCellCoordinate(max.x, index.cellSize);
+    int32_t maxY = getCellCoordinate(max.y, index.cellSize);
+    if(maxX < minX || maxY < minY) return;
+    double rangeCount = (double(maxX) - double(minX) + 1.0) * (double(maxY) - double(minY) + 1.0);
+    if(rangeCount > double(index.cells.size())){
+        for(const auto& [key, cell] : index.cells){
+            int32_t x = int32_t(uint32_t(key >> 32));
+            int32_t y = int32_t(uint32_t(key));
+            if(x >= minX && x <= maxX && y >= minY && y <= maxY) fn(cell);
+        }
+        return;
+    }
+    for(int32_t y = minY; y <= maxY; y++){
+        for(int32_t x = minX; x <= maxX; x++){
+            auto it = index.cells.find(getCellKey(x, y));
+            if(it != index.cells.end()) fn(it->second);
+        }
+    }
+}
+
+void rebuildSpatialIndex(Patch::SpatialIndex& index, const Patch::PixelStore& store){
+    uint32_t pixelCount = uint32_t(store.x.size());
+    index.cells.clear();
+    index.pixelCell.resize(pixelCount);
+    index.pixelSlot.resize(pixelCount);
+    for(uint32_t i = 0; i < pixelCount; i++) insertPixel(index, i, getPixelKey(index, store, i));
+}
+
+void updateSpatialIndex(Patch::SpatialIndex& index, const Patch::PixelStore& store, uint32_t begin, uint32_t end){
+    end = std::min(end, uint32_t(index.pixelCell.size()));
+    for(uint32_t i = begin; i < end; i++){
+        uint64_t key = getPixelKey(index, store, i);
+        if(key == index.pixelCell[i]) continue;
+        removePixel(index, i);
+        insertPixel(index, i, key);
+    }
+}
+
+int64_t findNearestPixel(const Patch::SpatialIndex& index, const Patch::PixelStore& store, glm::vec2 point, float maxDistance){
+    int64_t nearest = -1;
+    float nearestDistance2 = maxDistance * maxDistance;
+    forEachCell(index, point - glm::vec2(maxDistance), point + glm::vec2(maxDistance),
+        [&](const std::vector<uint32_t>& cell){
+            for(uint32_t pixel : cell){
+                float dx = store.x[pixel] - point.x;
+                float dy = store.y[pixel] - point.y;
+                float distance2 = dx * dx + dy * dy;
+                if(distance2 <= nearestDistance2){
+                    nearestDistance2 = distance2;
+                    nearest = pixel;
+                }
+            }
+    });
+    return nearest;
+}
+
+void findPixelsInRect(const Patch::SpatialIndex& index, const Patch::PixelStore& store, glm::vec2 min, glm::vec2 max, std::vector<uint32_t>& pixels){
+    forEachCell(index, min, max,
+        [&](const std::vector<uint32_t>& cell){
+            for(uint32_t pixel : cell){
+                float x = store.x[pixel];
+                float y = store.y[pixel];
+                if(x >= min.x && x <= max.x && y >= min.y && y <= max.y) pixels.push_back(pixel);
+            }
+    });
+}
+
+}//namespace PixelMapper::Render
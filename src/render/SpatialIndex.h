@@ -0,0 +1,19 @@
+#pragma once
+
+#include "PixelMapper.h"
+
+namespace PixelMapper::Render{
+
+    //puts every pixel of the store into its cell
+    void rebuildSpatialIndex(Patch::SpatialIndex& index, const Patch::PixelStore& store);
+
+    //moves pixels [begin, end) to the cells of their current positions, pixels that stay in their cell are not touched
+    void updateSpatialIndex(Patch::SpatialIndex& index, const Patch::PixelStore& store, uint32_t begin, uint32_t end);
+
+    //closest pixel within maxDistance of point, -1 if there is none
+    int64_t findNearestPixel(const Patch::SpatialIndex& index, const Patch::PixelStore& store, glm::vec2 point, float maxDistance);
+
+    //appends the pixels inside the rectangle [min, max] to pixels
+    void findPixelsInRect(const Patch::SpatialIndex& index, const Patch::PixelStore& store, glm::vec2 min, glm::vec2 max, std::vector<uint32_t>& pixels);
+
+}//namespace PixelMapper::Render
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+//Fires frames at a fixed rate on the monotonic clock
+//deadlines are accumulated (next += period) so timing errors don't drift over time,
+//waiting sleeps for the bulk of the interval and spins the last stretch for sub millisecond accuracy
+class FrameScheduler{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    //all intervals are in milliseconds
+    struct Statistics{
+        double minInterval = 0.0;
+        double maxInterval = 0.0;
+        double averageInterval = 0.0;
+        double p99Interval = 0.0;
+        uint64_t frameCount = 0;
+        uint64_t missedFrames = 0;
+    };
+
+    FrameScheduler(double rate = 44.0){ setRate(rate); }
+
+    //can be called from any thread, takes effect on the next frame
+    void setRate(double rate){
+        rate = std::clamp(rate, 1.0, 1000.0);
+        periodNanoseconds.store(int64_t(1e9 / rate), std::memory_order_relaxed);
+    }
+    double getRate() const { return 1e9 / double(periodNanoseconds.load(std::memory_order_relaxed)); }
+
+    //how early the sleep wakes up before spinning, os sleep granularity is around 1ms (worse on windows)
+    void setSpinThreshold(Clock::duration threshold){ spinThreshold = threshold; }
+
+    void reset(){
+        nextFrame = Clock::now();
+        lastFrame = Clock::time_point();
+    }
+
+    //blocks until the next frame deadline, returns the time at which the frame fired
+    Clock::time_point waitForNextFrame(){
+        if(nextFrame == Clock::time_point()) reset();
+        auto period = std::chrono::nanoseconds(periodNanoseconds.load(std::memory_order_relaxed));
+        nextFrame += period;
+
+        auto now = Clock::now();
+        //if we fell behind by more than a frame, drop the backlog instead of firing a burst of late frames
+        if(now > nextFrame + period){
+            missedFrames += (now - nextFrame) / period;
+            nextFrame = now;
+        }
+
+        if(nextFrame - now > spinThreshold) std::this_thread::sleep_until(nextFrame - spinThreshold);
+        while(Clock::now() < nextFrame) std::this_thread::yield();
+
+        auto fired = Clock::now();
+        if(lastFrame != Clock::time_point()) {
+            recordInterval(std::chrono::duration<double, std::milli>(fired - lastFrame).count());
+        }
+        lastFrame = fired;
+        return fired;
+    }
+
+    //thread safe snapshot, refreshed about once per second
+    Statistics getStatistics() const {
+        std::lock_guard<std::mutex> lock(statisticsMutex);
+        return statistics;
+    }
+
+private:
+
+    static constexpr size_t HistorySize = 4096;
+
+    void recordInterval(double interval){
+        intervals[historyIndex] = float(interval);
+        historyIndex = (historyIndex + 1) % HistorySize;
+        historyCount = std::min(historyCount + 1, HistorySize);
+        frameCount++;
+
+        windowMin = std::min(windowMin, interval);
+        windowMax = std::max(windowMax, interval);
+        windowSum += interval;
+        windowCount++;
+        if(windowSum >= 1000.0) updateStatistics();
+    }
+
+    void updateStatistics(){
+        //p99 over the recent history, nth_element runs on a preallocated scratch copy
+        std::copy(intervals.begin(), intervals.begin() + historyCount, scratch.begin());
+        size_t p99Index = std::min(historyCount - 1, size_t(double(historyCount) * 0.99));
+        std::nth_element(scratch.begin(), scratch.begin() + p99Index, scratch.begin() + historyCount);
+
+        std::lock_guard<std::mutex> lock(statisticsMutex);
+        statistics.minInterval = windowMin;
+        statistics.maxInterval = windowMax;
+        statistics.averageInterval = windowSum / double(windowCount);
+        statistics.p99Interval = scratch[p99Index];
+        statistics.frameCount = frameCount;
+        statistics.missedFrames = missedFrames;
+
+        windowMin = std::numeric_limits<double>::max();
+        windowMax = 0.0;
+        windowSum = 0.0;
+        windowCount = 0;
+    }
+
+    std::atomic<int64_t> periodNanoseconds;
+    Clock::duration spinThreshold = std::chrono::microseconds(1500);
+    Clock::time_point nextFrame;
+    Clock::time_point lastFrame;
+
+    std::array<float, HistorySize> intervals;
+    std::array<float, HistorySize> scratch;
+    size_t historyIndex = 0;
+    size_t historyCount = 0;
+    uint64_t frameCount = 0;
+    uint64_t missedFrames = 0;
+
+    double windowMin = std::numeric_limits<double>::max();
+    double windowMax = 0.0;
+    double windowSum = 0.0;
+    uint64_t windowCount = 0;
+
+    mutable std::mutex statisticsMutex;
+    Statistics statistics;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+//Read only memory mapping of a whole file
+//pages are loaded lazily by the os, so reading a record only touches the pages it lives in
+class MappedFile{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const char* path){ open(path); }
+    ~MappedFile(){ close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path){
+        close();
+#if defined(_WIN32)
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if(file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0){ close(); return false; }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mapping == nullptr){ close(); return false; }
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(view == nullptr){ close(); return false; }
+        bytes = static_cast<const uint8_t*>(view);
+        byteCount = size_t(fileSize.QuadPart);
+#else
+        int fd = ::open(path, O_RDONLY);
+        if(fd < 0) return false;
+        struct stat info;
+        if(fstat(fd, &info) != 0 || info.st_size == 0){ ::close(fd); return false; }
+        void* view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); //the mapping keeps its own reference to the file
+        if(view == MAP_FAILED) return false;
+        //records are read front to back exactly once
+        madvise(view, size_t(info.st_size), MADV_SEQUENTIAL);
+        bytes = static_cast<const uint8_t*>(view);
+        byteCount = size_t(info.st_size);
+#endif
+        return true;
+    }
+
+    void close(){
+#if defined(_WIN32)
+        if(bytes) UnmapViewOfFile(bytes);
+        if(mapping != nullptr) CloseHandle(mapping);
+        if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if(bytes) munmap(const_cast<uint8_t*>(bytes), byteCount);
+#endif
+        bytes = nullptr;
+        byteCount = 0;
+    }
+
+    bool isOpen() const { return bytes != nullptr; }
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return byteCount; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t byteCount = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
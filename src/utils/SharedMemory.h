@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+//Named read/write memory shared between processes
+//the creating side owns the name and removes it when closed, other processes open it by name
+class SharedMemory{
+public:
+    SharedMemory() = default;
+    ~SharedMemory(){ close(); }
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    bool create(const char* name, size_t size){
+        close();
+        std::string path = makePath(name);
+#if defined(_WIN32)
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, DWORD(uint64_t(size) >> 32), DWORD(size), path.c_str());
+        if(mapping == nullptr) return false;
+        if(!map(size)){ close(); return false; }
+#else
+        int fd = shm_open(path.c_str(), O_CREAT | O_RDWR, 0666);
+        if(fd < 0) return false;
+        if(ftruncate(fd, off_t(size)) != 0){ ::close(fd); shm_unlink(path.c_str()); return false; }
+        bool mapped = map(fd, size);
+        ::close(fd);
+        if(!mapped){ shm_unlink(path.c_str()); return false; }
+        ownedPath = path;
+#endif
+        return true;
+    }
+
+    bool open(const char* name){
+        close();
+        std::string path = makePath(name);
+#if defined(_WIN32)
+        mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, path.c_str());
+        if(mapping == nullptr) return false;
+        //the view size is not known upfront, map everything and ask for the region size
+        if(!map(0)){ close(); return false; }
+        MEMORY_BASIC_INFORMATION info;
+        if(VirtualQuery(bytes, &info, sizeof(info)) == 0){ close(); return false; }
+        byteCount = info.RegionSize;
+#else
+        int fd = shm_open(path.c_str(), O_RDWR, 0666);
+        if(fd < 0) return false;
+        struct stat info;
+        bool mapped = fstat(fd, &info) == 0 && info.st_size > 0 && map(fd, size_t(info.st_size));
+        ::close(fd);
+        if(!mapped) return false;
+#endif
+        return true;
+    }
+
+    void close(){
+#if defined(_WIN32)
+        if(bytes) UnmapViewOfFile(bytes);
+        if(mapping != nullptr) CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        if(bytes) munmap(bytes, byteCount);
+        if(!ownedPath.empty()) shm_unlink(ownedPath.c_str());
+        ownedPath.clear();
+#endif
+        bytes = nullptr;
+        byteCount = 0;
+    }
+
+    bool isOpen() const { return bytes != nullptr; }
+    uint8_t* data() const { return bytes; }
+    size_t size() const { return byteCount; }
+
+private:
+    static std::string makePath(const char* name){
+#if defined(_WIN32)
+        return std::string("Local\\") + name;
+#else
+        return std::string("/") + name;
+#endif
+    }
+
+#if defined(_WIN32)
+    bool map(size_t size){
+        void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        if(view == nullptr) return false;
+        bytes = static_cast<uint8_t*>(view);
+        byteCount = size;
+        return true;
+    }
+    HANDLE mapping = nullptr;
+#else
+    bool map(int fd, size_t size){
+        void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(view == MAP_FAILED) return false;
+        bytes = static_cast<uint8_t*>(view);
+        byteCount = size;
+        return true;
+    }
+    std::string ownedPath;
+#endif
+
+    uint8_t* bytes = nullptr;
+    size_t byteCount = 0;
+};
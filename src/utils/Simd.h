@@ -0,0 +1,17 @@
+#pragma once
+
+//Compile time selection of the 128 bit vector instructions used by the hand written kernels
+//sse2 is part of every x86-64 target and neon of every arm64 target, so there is no runtime dispatch,
+//other targets (and 32 bit x86 built without sse2) use the scalar loops of each kernel.
+//PIXELMAPPER_SIMD_NAME names the selected set for benchmark and check output
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define PIXELMAPPER_SSE2
+    #define PIXELMAPPER_SIMD_NAME "SSE2"
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #define PIXELMAPPER_NEON
+    #define PIXELMAPPER_SIMD_NAME "NEON"
+    #include <arm_neon.h>
+#else
+    #define PIXELMAPPER_SIMD_NAME "Scalar"
+#endif
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed pool of worker threads running data parallel loops
+//a loop is cut into chunks whose boundaries only depend on count and chunkSize,
+//workers and the calling thread pull chunks from a shared counter until all are done.
+//loops started from inside a running loop (or while another thread owns the pool) run inline on the caller
+class ThreadPool{
+public:
+
+    explicit ThreadPool(unsigned threadCount = std::max(1u, std::thread::hardware_concurrency())){
+        //the calling thread works too, so we only start threadCount - 1 workers
+        for(unsigned i = 1; i < threadCount; i++) workers.emplace_back([this](){ workerLoop(); });
+    }
+
+    ~ThreadPool(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            b_stopping = true;
+        }
+        wakeWorkers.notify_all();
+        for(auto& worker : workers) worker.join();
+    }
+
+    static ThreadPool& getShared(){
+        static ThreadPool pool;
+        return pool;
+    }
+
+    unsigned getThreadCount() const { return unsigned(workers.size()) + 1; }
+
+    void parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t begin, size_t end)>& fn){
+        if(count == 0) return;
+        chunkSize = std::max<size_t>(chunkSize, 1);
+        size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+        std::unique_lock<std::mutex> owner(ownerMutex, std::try_to_lock);
+        if(chunkCount == 1 || workers.empty() || t_insideLoop || !owner.owns_lock()){
+            for(size_t begin = 0; begin < count; begin += chunkSize) fn(begin, std::min(count, begin + chunkSize));
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job.fn = &fn;
+            job.count = count;
+            job.chunkSize = chunkSize;
+            job.chunkCount = chunkCount;
+            job.nextChunk = 0;
+            job.remainingChunks = chunkCount;
+            generation++;
+        }
+        wakeWorkers.notify_all();
+
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        jobDone.wait(lock, [this](){ return job.remainingChunks.load() == 0 && activeWorkers == 0; });
+        job.fn = nullptr;
+    }
+
+private:
+
+    struct Job{
+        const std::function<void(size_t, size_t)>* fn = nullptr;
+        size_t count = 0;
+        size_t chunkSize = 0;
+        size_t chunkCount = 0;
+        std::atomic<size_t> nextChunk{0};
+        std::atomic<size_t> remainingChunks{0};
+    };
+
+    void runChunks(){
+        t_insideLoop = true;
+        while(true){
+            size_t chunk = job.nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if(chunk >= job.chunkCount) break;
+            size_t begin = chunk * job.chunkSize;
+            (*job.fn)(begin, std::min(job.count, begin + job.chunkSize));
+            job.remainingChunks.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        t_insideLoop = false;
+    }
+
+    void workerLoop(){
+        uint64_t seenGeneration = 0;
+        while(true){
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeWorkers.wait(lock, [&](){ return b_stopping || generation != seenGeneration; });
+                if(b_stopping) return;
+                seenGeneration = generation;
+                if(!job.fn) continue;
+                activeWorkers++;
+            }
+            runChunks();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                activeWorkers--;
+            }
+            jobDone.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex ownerMutex;
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable jobDone;
+    Job job;
+    uint64_t generation = 0;
+    int activeWorkers = 0;
+    bool b_stopping = false;
+
+    static inline thread_local bool t_insideLoop = false;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+//Lock-free single producer / single consumer triple buffer
+//the producer always has a free buffer to write into and never waits on the consumer,
+//the consumer always picks up the most recently published buffer and skips older ones
+template<typename T>
+class TripleBuffer{
+public:
+
+    //producer side
+    T& getWriteBuffer(){ return buffers[writeIndex]; }
+    void publish(){
+        uint8_t previous = middle.exchange(writeIndex | FreshBit, std::memory_order_acq_rel);
+        writeIndex = previous & IndexMask;
+    }
+
+    //consumer side, returns true if a new buffer was published since the last update
+    bool update(){
+        if(!(middle.load(std::memory_order_relaxed) & FreshBit)) return false;
+        uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & IndexMask;
+        return true;
+    }
+    const T& getReadBuffer() const { return buffers[readIndex]; }
+
+private:
+    static constexpr uint8_t IndexMask = 0x3;
+    static constexpr uint8_t FreshBit = 0x4;
+
+    T buffers[3];
+    alignas(64) uint8_t writeIndex = 0;
+    alignas(64) uint8_t readIndex = 1;
+    alignas(64) std::atomic<uint8_t> middle{2};
+};